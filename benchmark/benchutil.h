@@ -0,0 +1,171 @@
+#pragma once
+#ifndef _BENCHUTIL_H
+#define _BENCHUTIL_H
+
+/*
+ * benchutil.h
+ * Timers and build information shared by the benchmark programs.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // syscall, clock_gettime
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wvtvoice.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define BENCH_TSC
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BENCH_PERF
+#endif
+
+// Build options of the oscillator, 0 or 1
+#ifdef OVS_AUTO
+#define BENCH_OVS_AUTO 1
+#else
+#define BENCH_OVS_AUTO 0
+#endif
+#ifdef WTGEN_MIPMAP
+#define BENCH_MIPMAP 1
+#else
+#define BENCH_MIPMAP 0
+#endif
+#ifdef WTGEN_Q15
+#define BENCH_Q15 1
+#else
+#define BENCH_Q15 0
+#endif
+#ifdef WTGEN_UNFOLD
+#define BENCH_UNFOLD 1
+#else
+#define BENCH_UNFOLD 0
+#endif
+#ifdef WTGEN_SMOOTH
+#define BENCH_SMOOTH 1
+#else
+#define BENCH_SMOOTH 0
+#endif
+
+// Cycle counter
+typedef enum {
+    COUNTER_NONE = 0, // no cycle counter, cycles are reported as 0
+    COUNTER_PERF, // Linux perf_event, core cycles
+    COUNTER_TSC // time stamp counter, reference cycles
+} CounterType;
+
+static const char* const COUNTER_NAMES[] = { "none", "perf", "tsc" };
+
+static CounterType g_counter = COUNTER_NONE;
+#ifdef BENCH_PERF
+static int g_perf_fd = -1;
+#endif
+
+/*  counter_open
+    Select the cycle counter: perf_event core cycles if allowed, otherwise TSC.
+    use_perf: 0 - TSC only (a read costs a few cycles, for timing single blocks)
+*/
+static inline void counter_open(int use_perf)
+{
+#ifdef BENCH_PERF
+    if (use_perf) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        g_perf_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (g_perf_fd >= 0) {
+            ioctl(g_perf_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(g_perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+            g_counter = COUNTER_PERF;
+            return;
+        }
+    }
+#else
+    (void)use_perf;
+#endif
+#ifdef BENCH_TSC
+    g_counter = COUNTER_TSC;
+#endif
+}
+
+/*  counter_read
+    Returns: current value of the cycle counter
+*/
+static inline uint64_t counter_read(void)
+{
+    switch (g_counter) {
+#ifdef BENCH_PERF
+    case COUNTER_PERF: {
+        uint64_t value = 0;
+        if (read(g_perf_fd, &value, sizeof(value)) != (ssize_t)sizeof(value))
+            return 0;
+        return value;
+    }
+#endif
+#ifdef BENCH_TSC
+    case COUNTER_TSC:
+        return __rdtsc();
+#endif
+    default:
+        return 0;
+    }
+}
+
+/*  time_ns
+    Returns: monotonic time in nanoseconds
+*/
+static inline double time_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER t, f;
+    QueryPerformanceCounter(&t);
+    QueryPerformanceFrequency(&f);
+    return (double)t.QuadPart * 1e9 / (double)f.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+#endif
+}
+
+/*  counter_rate
+    Measure the counter rate against the monotonic clock.
+    Returns: counter ticks per ns, 0 if there is no counter
+*/
+static inline double counter_rate(void)
+{
+    if (g_counter == COUNTER_NONE)
+        return 0;
+    const double t0 = time_ns();
+    const uint64_t c0 = counter_read();
+    double t1;
+    do {
+        t1 = time_ns();
+    } while (t1 - t0 < 50e6); // 50 ms
+    return (double)(counter_read() - c0) / (t1 - t0);
+}
+
+#endif
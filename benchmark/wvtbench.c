@@ -0,0 +1,278 @@
+/*
+ * wvtbench.c
+ * Benchmark of the WvTable oscillator on the host.
+ * Times OSC_CYCLE for all the wavetable numbers (3 modes x 32 tables),
+ * with skew on and off, over a range of pitches, with the envelope and the LFOs active.
+ * Reports ns/sample, cycles/sample and their variance over repeated runs, as CSV or JSON.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include "benchutil.h"
+
+#define MAX_BLOCK 1024 // maximum number of samples per OSC_CYCLE call
+#define NUM_TABLES 96 // wavetable numbers, 3 modes x 32 tables
+#define SKEW_VALUE 256 // shift+shape value used for the skew, breakpoint at 3/8 of the period
+
+static const uint8_t NOTES[] = { 24, 48, 72, 96 }; // benchmarked pitches (MIDI notes)
+#define NUM_NOTES (sizeof(NOTES) / sizeof(NOTES[0]))
+
+// Benchmark settings, from the command line
+typedef struct {
+    uint32_t reps; // number of timed runs per configuration
+    uint32_t frames; // number of samples per run
+    uint32_t block; // number of samples per OSC_CYCLE call
+    int table; // single wavetable number, -1: all
+    int json; // 1: JSON output, 0: CSV
+    const char* outname; // output file name, NULL: stdout
+} BenchOptions;
+
+// Mean, variance and minimum of the measured values
+typedef struct {
+    double mean;
+    double var;
+    double min;
+} Stats;
+
+// Result for one configuration
+typedef struct {
+    uint8_t wt_num; // wavetable number, 0..95
+    uint8_t skew; // 1: skew on
+    uint8_t note; // MIDI note
+    Stats ns; // ns/sample
+    Stats cycles; // cycles/sample
+} BenchResult;
+
+static volatile int32_t g_sink; // keeps the generated samples alive
+
+/*  get_stats
+    Calculate the mean, the variance and the minimum of n values.
+*/
+static Stats get_stats(const double* x, uint32_t n)
+{
+    Stats s = { 0, 0, x[0] };
+    uint32_t i;
+    for (i = 0; i < n; i++) {
+        s.mean += x[i];
+        if (x[i] < s.min)
+            s.min = x[i];
+    }
+    s.mean /= n;
+    for (i = 0; i < n; i++)
+        s.var += (x[i] - s.mean) * (x[i] - s.mean);
+    s.var = (n > 1) ? s.var / (n - 1) : 0;
+    return s;
+}
+
+/*  setup_osc
+    Initialize the oscillator for a configuration.
+    The envelope (ASR) and LFO2 modulate the wave index, as in a typical patch.
+*/
+static void setup_osc(uint8_t wt_num, uint8_t skew)
+{
+    OSC_INIT(0, 0);
+    OSC_PARAM(k_user_osc_param_id1, wt_num);
+    OSC_PARAM(k_user_osc_param_id2, 20); // envelope attack
+    OSC_PARAM(k_user_osc_param_id3, 160); // ASR envelope, decay 60
+    OSC_PARAM(k_user_osc_param_id4, 150); // envelope amount +50
+    OSC_PARAM(k_user_osc_param_id5, 60); // LFO2 rate
+    OSC_PARAM(k_user_osc_param_id6, 30); // LFO2 amount
+    OSC_PARAM(k_user_osc_param_shape, 200); // wave index
+    OSC_PARAM(k_user_osc_param_shiftshape, skew ? SKEW_VALUE : 0);
+}
+
+/*  render
+    Generate frames samples in blocks, with the shape LFO of the host (triangle).
+*/
+static void render(user_osc_param_t* params, int32_t* buf, uint32_t frames, uint32_t block, uint32_t* nblock)
+{
+    int32_t sum = 0;
+    while (frames) {
+        const uint32_t n = (frames < block) ? frames : block;
+        const uint32_t tri = (*nblock)++ & 0xFF; // period: 256 blocks
+        params->shape_lfo = (int32_t)((tri < 128) ? tri : 255 - tri) << 20;
+        OSC_CYCLE(params, buf, n);
+        sum += buf[n - 1];
+        frames -= n;
+    }
+    g_sink += sum;
+}
+
+/*  bench_config
+    Time one configuration.
+*/
+static void bench_config(const BenchOptions* opt, BenchResult* res, double* ns, double* cycles)
+{
+    static int32_t buf[MAX_BLOCK];
+    user_osc_param_t params;
+    uint32_t nblock = 0;
+    uint32_t r;
+
+    memset(&params, 0, sizeof(params));
+    params.pitch = (uint16_t)(res->note << 8);
+    setup_osc(res->wt_num, res->skew);
+    OSC_NOTEON(&params);
+    render(&params, buf, opt->frames / 4, opt->block, &nblock); // warm up
+    for (r = 0; r < opt->reps; r++) {
+        const uint64_t c0 = counter_read();
+        const double t0 = time_ns();
+        render(&params, buf, opt->frames, opt->block, &nblock);
+        const double t1 = time_ns();
+        const uint64_t c1 = counter_read();
+        ns[r] = (t1 - t0) / opt->frames;
+        cycles[r] = (double)(c1 - c0) / opt->frames;
+    }
+    res->ns = get_stats(ns, opt->reps);
+    res->cycles = get_stats(cycles, opt->reps);
+}
+
+/*  write_results
+    Write the results as CSV or JSON.
+*/
+static void write_results(FILE* f, const BenchOptions* opt, const BenchResult* res, uint32_t nres)
+{
+    uint32_t i;
+    if (!opt->json) {
+        fprintf(f, "wavetable,mode,table,skew,note,ns_per_sample,ns_var,ns_min,cycles_per_sample,cycles_var,cycles_min\n");
+        for (i = 0; i < nres; i++) {
+            const BenchResult* r = &res[i];
+            fprintf(f, "%u,%u,%u,%u,%u,%.4f,%.6f,%.4f,%.3f,%.5f,%.3f\n", r->wt_num, (r->wt_num >> 5) + 1, r->wt_num & 0x1F,
+                r->skew, r->note, r->ns.mean, r->ns.var, r->ns.min, r->cycles.mean, r->cycles.var, r->cycles.min);
+        }
+        return;
+    }
+    fprintf(f,
+        "{\n  \"build\": {\"ovs_default\": %d, \"ovs_auto\": %d, \"mipmap\": %d, \"q15\": %d, \"unfold\": %d, "
+        "\"smooth\": %d},\n",
+        1 << OVS_DEFAULT_LOG2, BENCH_OVS_AUTO, BENCH_MIPMAP, BENCH_Q15, BENCH_UNFOLD, BENCH_SMOOTH);
+    fprintf(f, "  \"counter\": \"%s\", \"reps\": %u, \"frames\": %u, \"block\": %u,\n", COUNTER_NAMES[g_counter],
+        opt->reps, opt->frames, opt->block);
+    fprintf(f, "  \"results\": [\n");
+    for (i = 0; i < nres; i++) {
+        const BenchResult* r = &res[i];
+        fprintf(f,
+            "    {\"wavetable\": %u, \"mode\": %u, \"table\": %u, \"skew\": %u, \"note\": %u, "
+            "\"ns_per_sample\": %.4f, \"ns_var\": %.6f, \"ns_min\": %.4f, "
+            "\"cycles_per_sample\": %.3f, \"cycles_var\": %.5f, \"cycles_min\": %.3f}%s\n",
+            r->wt_num, (r->wt_num >> 5) + 1, r->wt_num & 0x1F, r->skew, r->note, r->ns.mean, r->ns.var, r->ns.min,
+            r->cycles.mean, r->cycles.var, r->cycles.min, (i + 1 < nres) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+/*  write_summary
+    Print the mean ns/sample of each mode and the slowest configuration to stderr.
+*/
+static void write_summary(const BenchResult* res, uint32_t nres)
+{
+    double sum[3] = { 0, 0, 0 };
+    uint32_t cnt[3] = { 0, 0, 0 };
+    uint32_t worst = 0;
+    uint32_t i;
+    for (i = 0; i < nres; i++) {
+        const uint32_t m = res[i].wt_num >> 5;
+        sum[m] += res[i].ns.mean;
+        cnt[m]++;
+        if (res[i].ns.mean > res[worst].ns.mean)
+            worst = i;
+    }
+    for (i = 0; i < 3; i++) {
+        if (cnt[i])
+            fprintf(stderr, "mode %u: %.3f ns/sample\n", i + 1, sum[i] / cnt[i]);
+    }
+    fprintf(stderr, "slowest: wavetable %u, skew %u, note %u: %.3f ns/sample\n", res[worst].wt_num, res[worst].skew,
+        res[worst].note, res[worst].ns.mean);
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [-f csv|json] [-o file] [-r reps] [-n frames] [-b block] [-w wavetable]\n"
+        "  -f  output format (default: csv)\n"
+        "  -o  output file (default: stdout)\n"
+        "  -r  timed runs per configuration (default: 16)\n"
+        "  -n  samples per run (default: 4096)\n"
+        "  -b  samples per OSC_CYCLE call (default: 32, max %d)\n"
+        "  -w  benchmark a single wavetable number, 0..95 (default: all)\n",
+        name, MAX_BLOCK);
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions opt = { 16, 4096, 32, -1, 0, NULL };
+    int i;
+    for (i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if ((arg[0] != '-') || !arg[1] || arg[2] || (i + 1 >= argc)) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* val = argv[++i];
+        switch (arg[1]) {
+        case 'f':
+            opt.json = !strcmp(val, "json");
+            break;
+        case 'o':
+            opt.outname = val;
+            break;
+        case 'r':
+            opt.reps = (uint32_t)atoi(val);
+            break;
+        case 'n':
+            opt.frames = (uint32_t)atoi(val);
+            break;
+        case 'b':
+            opt.block = (uint32_t)atoi(val);
+            break;
+        case 'w':
+            opt.table = atoi(val);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!opt.reps || !opt.frames || !opt.block || (opt.block > MAX_BLOCK) || (opt.table >= NUM_TABLES)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const uint32_t ntables = (opt.table < 0) ? NUM_TABLES : 1;
+    const uint32_t nres = ntables * 2 * NUM_NOTES;
+    BenchResult* res = (BenchResult*)calloc(nres, sizeof(BenchResult));
+    double* ns = (double*)malloc(opt.reps * sizeof(double));
+    double* cycles = (double*)malloc(opt.reps * sizeof(double));
+    if (!res || !ns || !cycles) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    counter_open(1);
+    uint32_t k = 0, t, s, p;
+    for (t = 0; t < ntables; t++) {
+        for (s = 0; s < 2; s++) {
+            for (p = 0; p < NUM_NOTES; p++) {
+                res[k].wt_num = (uint8_t)((opt.table < 0) ? t : (uint32_t)opt.table);
+                res[k].skew = (uint8_t)s;
+                res[k].note = NOTES[p];
+                bench_config(&opt, &res[k], ns, cycles);
+                k++;
+            }
+        }
+    }
+
+    FILE* f = opt.outname ? fopen(opt.outname, "w") : stdout;
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", opt.outname);
+        return 1;
+    }
+    write_results(f, &opt, res, nres);
+    if (f != stdout)
+        fclose(f);
+    write_summary(res, nres);
+    fprintf(stderr, "cycle counter: %s\n", COUNTER_NAMES[g_counter]);
+
+    free(res);
+    free(ns);
+    free(cycles);
+    return 0;
+}
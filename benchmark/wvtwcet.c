@@ -0,0 +1,298 @@
+/*
+ * wvtwcet.c
+ * Worst-case execution time (WCET) sweep of the WvTable oscillator callbacks.
+ * Searches the parameter space (wavetable, shape, skew, pitch, envelope) and times every
+ * OSC_CYCLE block of a note, including the block after OSC_NOTEON and OSC_NOTEOFF.
+ * Each note is repeated and the minimum time of each block is kept, so that interrupts
+ * and other tasks of the host do not count as the oscillator time.
+ * Writes a report with the maximum block time and the parameters that produced it.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include "benchutil.h"
+
+#define BLOCK 32 // samples per OSC_CYCLE call
+#define NUM_TABLES 96 // wavetable numbers, 3 modes x 32 tables
+#define NOTE_BLOCKS 48 // blocks from the note on to the note off
+#define RELEASE_BLOCKS 16 // blocks after the note off
+#define SEQ_BLOCKS (NOTE_BLOCKS + RELEASE_BLOCKS)
+#define NUM_WORST 20 // number of the worst configurations in the report
+
+static const uint16_t SHAPES[] = { 0, 256, 512, 768, 1023 }; // shape (wave index)
+static const uint16_t SKEWS[] = { 0, 64, 512, 960 }; // shift+shape (skew), 0: off
+static const uint8_t NOTES[] = { 0, 24, 48, 72, 96, 120, 127 }; // MIDI notes
+#define NUM_SHAPES (sizeof(SHAPES) / sizeof(SHAPES[0]))
+#define NUM_SKEWS (sizeof(SKEWS) / sizeof(SKEWS[0]))
+#define NUM_NOTES (sizeof(NOTES) / sizeof(NOTES[0]))
+
+// Envelope settings: attack, decay (param 3), amount (param 4)
+static const uint16_t ENVS[][3] = {
+    { 0, 0, 100 }, // envelope off
+    { 5, 30, 200 }, // fast AD envelope, full positive amount
+    { 20, 160, 1 }, // ASR envelope, full negative amount
+};
+#define NUM_ENVS (sizeof(ENVS) / sizeof(ENVS[0]))
+
+// Stage of the note in which a block is generated
+typedef enum {
+    STAGE_NOTEON = 0, // OSC_NOTEON + the first OSC_CYCLE
+    STAGE_HELD,
+    STAGE_NOTEOFF, // OSC_NOTEOFF + the next OSC_CYCLE
+    STAGE_RELEASE,
+    NUM_STAGES
+} NoteStage;
+
+static const char* const STAGE_NAMES[] = { "note on", "held", "note off", "release" };
+
+// Parameters and the worst block of one configuration
+typedef struct {
+    uint8_t wt_num; // wavetable number
+    uint16_t shape; // shape value
+    uint16_t skew; // shift+shape value
+    uint8_t note; // MIDI note
+    uint8_t env; // index into ENVS
+    uint8_t block; // block with the maximum time
+    double ns; // maximum block time, ns
+} WcetResult;
+
+// Sweep settings, from the command line
+typedef struct {
+    uint32_t reps; // repetitions of each note
+    int table; // single wavetable number, -1: all
+    double limit; // maximum allowed block time in ns, 0: no limit
+    const char* outname; // report file name, NULL: stdout
+} WcetOptions;
+
+static volatile int32_t g_sink; // keeps the generated samples alive
+
+/*  ticks
+    Returns: current time in counter ticks (TSC), or in ns if there is no counter
+*/
+static double ticks(void)
+{
+    return (g_counter != COUNTER_NONE) ? (double)counter_read() : time_ns();
+}
+
+/*  block_stage
+    Returns: the note stage of a block
+*/
+static NoteStage block_stage(uint32_t b)
+{
+    if (b == 0)
+        return STAGE_NOTEON;
+    if (b < NOTE_BLOCKS)
+        return STAGE_HELD;
+    if (b == NOTE_BLOCKS)
+        return STAGE_NOTEOFF;
+    return STAGE_RELEASE;
+}
+
+/*  run_note
+    Play one note with the configuration parameters and time every block.
+    t: block times, in ticks
+*/
+static void run_note(const WcetResult* cfg, double* t)
+{
+    static int32_t buf[BLOCK];
+    user_osc_param_t params;
+    int32_t sum = 0;
+    uint32_t b;
+
+    memset(&params, 0, sizeof(params));
+    params.pitch = (uint16_t)(cfg->note << 8);
+    OSC_INIT(0, 0);
+    OSC_PARAM(k_user_osc_param_id1, cfg->wt_num);
+    OSC_PARAM(k_user_osc_param_id2, ENVS[cfg->env][0]);
+    OSC_PARAM(k_user_osc_param_id3, ENVS[cfg->env][1]);
+    OSC_PARAM(k_user_osc_param_id4, ENVS[cfg->env][2]);
+    OSC_PARAM(k_user_osc_param_id5, 100); // fastest LFO2
+    OSC_PARAM(k_user_osc_param_id6, 100);
+    OSC_PARAM(k_user_osc_param_shape, cfg->shape);
+    OSC_PARAM(k_user_osc_param_shiftshape, cfg->skew);
+
+    for (b = 0; b < SEQ_BLOCKS; b++) {
+        const double t0 = ticks();
+        if (b == 0)
+            OSC_NOTEON(&params);
+        else if (b == NOTE_BLOCKS)
+            OSC_NOTEOFF(&params);
+        OSC_CYCLE(&params, buf, BLOCK);
+        t[b] = ticks() - t0;
+        sum += buf[BLOCK - 1];
+    }
+    g_sink += sum;
+}
+
+/*  run_config
+    Time a configuration: the minimum time of each block over the repetitions,
+    then the maximum over the blocks.
+    mean: accumulates the mean block time, in ticks
+*/
+static void run_config(const WcetOptions* opt, WcetResult* cfg, double tick_ns, double* mean)
+{
+    double best[SEQ_BLOCKS];
+    double t[SEQ_BLOCKS];
+    uint32_t r, b;
+
+    run_note(cfg, best);
+    for (r = 1; r < opt->reps; r++) {
+        run_note(cfg, t);
+        for (b = 0; b < SEQ_BLOCKS; b++) {
+            if (t[b] < best[b])
+                best[b] = t[b];
+        }
+    }
+    cfg->block = 0;
+    for (b = 0; b < SEQ_BLOCKS; b++) {
+        *mean += best[b] / SEQ_BLOCKS;
+        if (best[b] > best[cfg->block])
+            cfg->block = (uint8_t)b;
+    }
+    cfg->ns = best[cfg->block] * tick_ns;
+}
+
+/*  insert_worst
+    Keep the NUM_WORST configurations with the largest block time, sorted.
+*/
+static void insert_worst(WcetResult* worst, uint32_t* nworst, const WcetResult* cfg)
+{
+    uint32_t i = (*nworst < NUM_WORST) ? (*nworst)++ : NUM_WORST;
+    while ((i > 0) && (worst[i - 1].ns < cfg->ns)) {
+        if (i < NUM_WORST)
+            worst[i] = worst[i - 1];
+        i--;
+    }
+    if (i < NUM_WORST)
+        worst[i] = *cfg;
+}
+
+static void print_config(FILE* f, const WcetResult* r)
+{
+    fprintf(f, "%8.0f ns %7.2f ns/sample  wavetable %2u  shape %4u  skew %4u  note %3u  env %u  %-8s (block %u)\n", r->ns,
+        r->ns / BLOCK, r->wt_num, r->shape, r->skew, r->note, r->env, STAGE_NAMES[block_stage(r->block)], r->block);
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [-o file] [-r reps] [-w wavetable] [-l limit]\n"
+        "  -o  report file (default: stdout)\n"
+        "  -r  repetitions of each note (default: 3)\n"
+        "  -w  sweep a single wavetable number, 0..95 (default: all)\n"
+        "  -l  maximum allowed block time in ns, exit code 2 if exceeded (default: no limit)\n",
+        name);
+}
+
+int main(int argc, char* argv[])
+{
+    WcetOptions opt = { 3, -1, 0, NULL };
+    int i;
+    for (i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if ((arg[0] != '-') || !arg[1] || arg[2] || (i + 1 >= argc)) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* val = argv[++i];
+        switch (arg[1]) {
+        case 'o':
+            opt.outname = val;
+            break;
+        case 'r':
+            opt.reps = (uint32_t)atoi(val);
+            break;
+        case 'w':
+            opt.table = atoi(val);
+            break;
+        case 'l':
+            opt.limit = atof(val);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!opt.reps || (opt.table >= NUM_TABLES)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    counter_open(0); // TSC: the perf counter is too slow to read for every block
+    const double rate = counter_rate();
+    const double tick_ns = (rate > 0) ? 1. / rate : 1.;
+
+    WcetResult worst[NUM_WORST];
+    WcetResult stage_worst[NUM_STAGES];
+    WcetResult table_worst[NUM_TABLES];
+    uint32_t nworst = 0;
+    uint32_t nconfig = 0;
+    double mean = 0;
+    memset(stage_worst, 0, sizeof(stage_worst));
+    memset(table_worst, 0, sizeof(table_worst));
+
+    const uint32_t t_first = (opt.table < 0) ? 0 : (uint32_t)opt.table;
+    const uint32_t t_last = (opt.table < 0) ? NUM_TABLES - 1 : (uint32_t)opt.table;
+    uint32_t t, sh, sk, n, e;
+    for (t = t_first; t <= t_last; t++) {
+        for (sh = 0; sh < NUM_SHAPES; sh++) {
+            for (sk = 0; sk < NUM_SKEWS; sk++) {
+                for (n = 0; n < NUM_NOTES; n++) {
+                    for (e = 0; e < NUM_ENVS; e++) {
+                        WcetResult cfg = { (uint8_t)t, SHAPES[sh], SKEWS[sk], NOTES[n], (uint8_t)e, 0, 0 };
+                        run_config(&opt, &cfg, tick_ns, &mean);
+                        nconfig++;
+                        insert_worst(worst, &nworst, &cfg);
+                        const NoteStage s = block_stage(cfg.block);
+                        if (cfg.ns > stage_worst[s].ns)
+                            stage_worst[s] = cfg;
+                        if (cfg.ns > table_worst[t].ns)
+                            table_worst[t] = cfg;
+                    }
+                }
+            }
+        }
+    }
+    mean = mean * tick_ns / nconfig;
+
+    FILE* f = opt.outname ? fopen(opt.outname, "w") : stdout;
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", opt.outname);
+        return 1;
+    }
+    fprintf(f, "WvTable WCET report\n\n");
+    fprintf(f, "build: oversampling %dx, ovs_auto %d, mipmap %d, q15 %d, unfold %d, smooth %d\n", 1 << OVS_DEFAULT_LOG2,
+        BENCH_OVS_AUTO, BENCH_MIPMAP, BENCH_Q15, BENCH_UNFOLD, BENCH_SMOOTH);
+    fprintf(f, "timer: %s", COUNTER_NAMES[g_counter]);
+    if (rate > 0)
+        fprintf(f, " (%.3f ticks/ns)", rate);
+    fprintf(f, ", %u repetitions per note, minimum time of each block\n", opt.reps);
+    fprintf(f, "configurations: %u, %u blocks of %u samples each (note off at block %u)\n", nconfig, SEQ_BLOCKS, BLOCK,
+        NOTE_BLOCKS);
+    fprintf(f, "mean block: %.0f ns (%.2f ns/sample)\n", mean, mean / BLOCK);
+    fprintf(f, "\nworst block:\n");
+    print_config(f, &worst[0]);
+    fprintf(f, "\nworst block of each note stage:\n");
+    for (i = 0; i < NUM_STAGES; i++) {
+        if (stage_worst[i].ns > 0) {
+            fprintf(f, "%-8s ", STAGE_NAMES[i]);
+            print_config(f, &stage_worst[i]);
+        }
+    }
+    fprintf(f, "\nworst configurations:\n");
+    for (i = 0; i < (int)nworst; i++)
+        print_config(f, &worst[i]);
+    fprintf(f, "\nworst block of each wavetable:\n");
+    for (t = t_first; t <= t_last; t++)
+        print_config(f, &table_worst[t]);
+
+    int ret = 0;
+    if ((opt.limit > 0) && (worst[0].ns > opt.limit)) {
+        fprintf(f, "\nLIMIT EXCEEDED: %.0f ns > %.0f ns\n", worst[0].ns, opt.limit);
+        ret = 2;
+    }
+    if (f != stdout)
+        fclose(f);
+    fprintf(stderr, "worst block: %.0f ns, wavetable %u (%s)\n", worst[0].ns, worst[0].wt_num,
+        STAGE_NAMES[block_stage(worst[0].block)]);
+    return ret;
+}
@@ -7,14 +7,19 @@
 #endif
 
 #include <cstdint>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 
-#include <userosc2.h>
+#include <wvtvoice.h>
 
 static constexpr uint32_t blockSize = 32;
+static constexpr int numVoices = 8;
+static constexpr int minSubBlock = 8; // events closer than this to the previous split are applied early
 
 //==============================================================================
 /** A dummy synth sound. */
@@ -45,6 +50,11 @@ public:
         oscParam.cutoff = 0;
         oscParam.resonance = 0;
         // buffer.fill(0);
+        // each voice runs its own instance of the oscillator
+        wvt_init(&osc);
+        for (uint16_t i = 0; i < k_num_user_osc_param_id; ++i) {
+            wvt_param(&osc, i, 0);
+        }
     }
 
     bool canPlaySound(juce::SynthesiserSound* sound) override
@@ -53,10 +63,11 @@ public:
     }
 
     void startNote(int midiNoteNumber, float /*velocity*/, juce::SynthesiserSound* /*sound*/,
-        int /*currentPitchWheelPosition*/) override
+        int currentPitchWheelPosition) override
     {
-        oscParam.pitch = static_cast<uint16_t>(midiNoteNumber) << 8;
-        OSC_NOTEON(&oscParam);
+        note = midiNoteNumber;
+        pitchWheelMoved(currentPitchWheelPosition);
+        wvt_noteon(&osc, &oscParam);
         gain = 1.f;
     }
 
@@ -65,7 +76,7 @@ public:
         if (!isVoiceActive())
             return; // voice not running, no need to process
         // clearCurrentNote(); // temporary
-        OSC_NOTEOFF(&oscParam);
+        wvt_noteoff(&osc);
         if (allowTailOff) { // start tail off
             gain = tailAlpha.get();
         } else { // stop the note now
@@ -73,7 +84,20 @@ public:
         }
     }
 
-    void pitchWheelMoved(int /*newValue*/) override { }
+    // Run the oscillator at the host rate (called by the synth in prepareToPlay, the audio thread is stopped)
+    void setCurrentPlaybackSampleRate(double newRate) override
+    {
+        juce::SynthesiserVoice::setCurrentPlaybackSampleRate(newRate);
+        if (newRate > 0)
+            wvt_set_srate(&osc, static_cast<uint32_t>(newRate + 0.5));
+    }
+
+    // Pitch bend, +-2 semitones, ramped by the oscillator over the next block
+    void pitchWheelMoved(int newValue) override
+    {
+        const auto bend = (newValue - 8192) / 16; // 8192 = 2 semitones = 512 in UQ8.8
+        oscParam.pitch = static_cast<uint16_t>(juce::jlimit(0, 0xFFFF, (note << 8) + bend));
+    }
 
     void controllerMoved(int /*controllerNumber*/, int /*newValue*/) override { }
 
@@ -81,35 +105,45 @@ public:
     {
         // We need to run the oscillator, but we should not fill the buffer if the voice
         // is inactive. Otherwise, the sound never stops.
-        const auto active = isVoiceActive();
-
-        // sample rendering loop
-        while (--numSamples >= 0) {
-            if (bufIndex == blockSize) {
-                // generate new samples
-                OSC_CYCLE(&oscParam, buffer.data(), blockSize);
-                bufIndex = 0;
-            }
+        auto active = isVoiceActive();
+
+        // rendering loop, in oscillator blocks of up to blockSize samples
+        // The synth calls this function for the segments between the MIDI events (and the parameter changes),
+        // the samples are generated only up to the end of the segment, so that the events are applied
+        // at the exact sample. Without events, the segment is the whole host buffer, split into full blocks.
+        while (numSamples > 0) {
+            const auto n = std::min(numSamples, static_cast<int>(blockSize));
+            wvt_cycle(&osc, &oscParam, buffer.data(), static_cast<uint32_t>(n));
             if (active) {
-                const float currentSample = static_cast<float>(buffer[bufIndex++]) * 4.656612873077393e-10f * gain;
-                for (auto i = outputBuffer.getNumChannels(); --i >= 0;) {
-                    outputBuffer.addSample(i, startSample, currentSample);
-                }
+                // Q31 to float
+                juce::FloatVectorOperations::convertFixedToFloat(samples.data(), buffer.data(), 4.656612873077393e-10f, n);
                 if (gain < 1.f) {
-                    gain *= tailAlpha.get();
+                    // tail off: exponential decay, a linear ramp within the block
+                    const auto endGain = gain * std::pow(tailAlpha.get(), static_cast<float>(n));
+                    for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
+                        outputBuffer.addFromWithRamp(i, startSample, samples.data(), n, gain, endGain);
+                    gain = endGain;
                     if (gain < 0.0067f) { // about 5*tau
                         clearCurrentNote();
                         gain = 0;
+                        active = false;
                     }
+                } else {
+                    for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
+                        outputBuffer.addFrom(i, startSample, samples.data(), n);
                 }
-            } else {
-                // no note playing in this voice
-                bufIndex++;
             }
-            ++startSample;
+            startSample += n;
+            numSamples -= n;
         }
     }
 
+    // Set a parameter of the oscillator
+    void setOscParam(uint16_t index, uint16_t value)
+    {
+        wvt_param(&osc, index, value);
+    }
+
     // Set alpha value for tail off
     static void setTailAlpha(float alpha)
     {
@@ -118,12 +152,82 @@ public:
 
 private:
     std::array<int32_t, blockSize> buffer = {};
-    uint32_t bufIndex = blockSize;
+    std::array<float, blockSize> samples = {}; // current block, converted to float
     user_osc_param_t oscParam;
+    WvTableVoice osc;
     float gain = 0.f; // local gain used for tail off
+    int note = 69; // MIDI note of the current note
     inline static juce::Atomic<float> tailAlpha { 0.f };
 };
 
+//==============================================================================
+/** Parameter changes sent from the message thread to the audio thread.
+    Single producer, single consumer: the audio thread reads without waiting.
+    Each change is timestamped with a sample offset within the next block. */
+
+class ParamQueue final {
+public:
+    struct Event {
+        int offset; // sample offset in the block
+        uint16_t index; // oscillator parameter index
+        uint16_t value; // parameter value
+    };
+
+    // Add a parameter change (producer)
+    void push(uint16_t index, uint16_t value)
+    {
+        // the host may change the parameters from more than one thread, the audio thread does not lock
+        const juce::SpinLock::ScopedLockType lock(pushLock);
+        const auto scope = fifo.write(1);
+        if (scope.blockSize1 > 0)
+            events[static_cast<size_t>(scope.startIndex1)] = { getOffset(), index, value };
+        else
+            jassertfalse; // full: the audio thread is not running
+    }
+
+    // Remove all the changes (consumer), call f(event) for each change
+    template <typename F>
+    void pop(F&& f)
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        scope.forEach([&](int i) { f(events[static_cast<size_t>(i)]); });
+    }
+
+    // Mark the start of a block (consumer)
+    void startBlock(double sampleRate)
+    {
+        rate.store(sampleRate, std::memory_order_relaxed);
+        blockStart.store(juce::Time::getHighResolutionTicks(), std::memory_order_relaxed);
+    }
+
+    // Remove all the changes, when the audio thread is stopped (the producers may still run)
+    void reset()
+    {
+        const juce::SpinLock::ScopedLockType lock(pushLock);
+        fifo.reset();
+        blockStart.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // Time since the start of the last block, in samples: the change is applied in the next block
+    // with the same delay, so the changes made during a block keep their timing.
+    int getOffset() const
+    {
+        const auto start = blockStart.load(std::memory_order_relaxed);
+        if (start == 0)
+            return 0;
+        const auto t = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        return static_cast<int>(t * rate.load(std::memory_order_relaxed));
+    }
+
+    static constexpr int capacity = 1024;
+    juce::AbstractFifo fifo { capacity };
+    std::array<Event, capacity> events = {};
+    juce::SpinLock pushLock;
+    std::atomic<juce::int64> blockStart { 0 };
+    std::atomic<double> rate { 48000.0 };
+};
+
 //==============================================================================
 /** The audio processor. */
 
@@ -134,16 +238,14 @@ public:
         : AudioProcessor(BusesProperties().withOutput("Output", juce::AudioChannelSet::stereo(), true))
         , state(*this, nullptr, "Parameters", createParameterLayout())
     {
-        // initialize the module (it's shared between the voices)
-        OSC_INIT(0, 0);
-        for (uint16_t i = 0; i < k_num_user_osc_param_id; ++i) {
-            OSC_PARAM(i, 0);
-        }
-
-        // initialize the synth
-        // for (auto i = 0; i < 4U; ++i)
-        synth.addVoice(new SynthVoice());
+        // initialize the synth, each voice has its own oscillator
+        for (auto i = 0; i < numVoices; ++i)
+            synth.addVoice(new SynthVoice());
         synth.addSound(new SynthSound());
+        // split the rendering at the MIDI event positions (default: 32 samples), events closer than
+        // minSubBlock samples to the previous split are handled early, without tiny blocks;
+        // not strict: the first event of the block is always at its exact position
+        synth.setMinimumRenderingSubdivisionSize(minSubBlock, false);
         SynthVoice::setTailAlpha(0.9997916883665486f); // 0.5 s
 
         // create pointers to parameters
@@ -155,6 +257,11 @@ public:
         paramEnvAmount = dynamic_cast<juce::AudioParameterInt*>(state.getParameter("env_amount"));
         paramLfoRate = dynamic_cast<juce::AudioParameterInt*>(state.getParameter("lfo_rate"));
         paramLfoAmount = dynamic_cast<juce::AudioParameterInt*>(state.getParameter("lfo_amount"));
+        paramLfoShape = dynamic_cast<juce::AudioParameterChoice*>(state.getParameter("lfo_shape"));
+        paramLfoFree = dynamic_cast<juce::AudioParameterBool*>(state.getParameter("lfo_free"));
+        paramLfoDelay = dynamic_cast<juce::AudioParameterInt*>(state.getParameter("lfo_delay"));
+        paramGlide = dynamic_cast<juce::AudioParameterInt*>(state.getParameter("glide"));
+        paramOvs = dynamic_cast<juce::AudioParameterChoice*>(state.getParameter("ovs"));
         paramRelease = dynamic_cast<juce::AudioParameterFloat*>(state.getParameter("release"));
         paramGain = dynamic_cast<juce::AudioParameterFloat*>(state.getParameter("gain"));
 
@@ -167,6 +274,11 @@ public:
         state.addParameterListener("env_amount", this);
         state.addParameterListener("lfo_rate", this);
         state.addParameterListener("lfo_amount", this);
+        state.addParameterListener("lfo_shape", this);
+        state.addParameterListener("lfo_free", this);
+        state.addParameterListener("lfo_delay", this);
+        state.addParameterListener("glide", this);
+        state.addParameterListener("ovs", this);
         state.addParameterListener("release", this);
     }
 
@@ -189,6 +301,12 @@ public:
     void prepareToPlay(double sampleRate, int /*samplesPerBlock*/) override
     {
         synth.setCurrentPlaybackSampleRate(sampleRate);
+        segmentMidi.ensureSize(4096); // no allocation in processBlock for the usual event counts
+        // the audio thread is stopped: send the current values again, the queue may have been full
+        paramQueue.reset();
+        for (const auto* id : { "release", "wave", "skew", "wavetable", "env_attack", "env_decay", "env_amount", "lfo_rate",
+                 "lfo_amount", "lfo_shape", "lfo_free", "lfo_delay", "glide", "ovs" })
+            parameterChanged(id, 0.f);
     }
 
     void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
@@ -198,7 +316,31 @@ public:
         for (auto i = getTotalNumInputChannels(); i < getTotalNumOutputChannels(); ++i)
             buffer.clear(i, 0, numSamples);
 
-        synth.renderNextBlock(buffer, midiMessages, 0, numSamples);
+        // Apply the parameter changes at their offsets, the synth is rendered in segments between them.
+        // Only the audio thread changes the oscillator state.
+        // Each segment gets only its own MIDI events: the synth handles the first event past the end
+        // of the segment before it stops, with the whole buffer it would be handled again by the next segment.
+        auto pos = 0;
+        auto renderSegment = [&](int end) {
+            if (pos == 0 && end == numSamples) {
+                synth.renderNextBlock(buffer, midiMessages, 0, numSamples); // no parameter changes
+            } else {
+                segmentMidi.clear();
+                segmentMidi.addEvents(midiMessages, pos, end - pos, 0);
+                synth.renderNextBlock(buffer, segmentMidi, pos, end - pos);
+            }
+            pos = end;
+        };
+        paramQueue.pop([&](const ParamQueue::Event& event) {
+            // (the changes closer than minSubBlock to the previous split are applied early, as MIDI events)
+            const auto offset = juce::jlimit(pos, numSamples, event.offset);
+            if (offset - pos >= ((pos == 0) ? 1 : minSubBlock))
+                renderSegment(offset);
+            setOscParam(event.index, event.value);
+        });
+        paramQueue.startBlock(getSampleRate());
+        if (pos < numSamples)
+            renderSegment(numSamples);
 
         for (auto channel = 0; channel < getTotalNumOutputChannels(); ++channel)
             // buffer.applyGain(channel, 0, numSamples, state.getParameter("gain")->getValue());
@@ -267,33 +409,53 @@ public:
 
     void setStateInformation(const void* /*data*/, int /*sizeInBytes*/) override { }
 
-    // Callback for partameter changes
+    // Callback for partameter changes, the oscillator parameters are queued for the audio thread
     void parameterChanged(const juce::String& id, float) override
     {
         if (id == "release") {
             const float tailTime = paramRelease->get();
-            const float alpha = std::exp(-5.f / (tailTime * 48000.f));
+            const auto sampleRate = (getSampleRate() > 0) ? static_cast<float>(getSampleRate()) : 48000.f;
+            const float alpha = std::exp(-5.f / (tailTime * sampleRate));
             SynthVoice::setTailAlpha(alpha);
         } else if (id == "wave") {
-            OSC_PARAM(k_user_osc_param_shape, static_cast<uint16_t>(paramWave->get()));
+            paramQueue.push(k_user_osc_param_shape, static_cast<uint16_t>(paramWave->get()));
         } else if (id == "skew") {
-            OSC_PARAM(k_user_osc_param_shiftshape, static_cast<uint16_t>(paramSkew->get()));
+            paramQueue.push(k_user_osc_param_shiftshape, static_cast<uint16_t>(paramSkew->get()));
         } else if (id == "wavetable") {
-            OSC_PARAM(k_user_osc_param_id1, static_cast<uint16_t>(paramWavetable->get()));
+            paramQueue.push(k_user_osc_param_id1, static_cast<uint16_t>(paramWavetable->get()));
         } else if (id == "env_attack") {
-            OSC_PARAM(k_user_osc_param_id2, static_cast<uint16_t>(paramEnvAttack->get()));
+            paramQueue.push(k_user_osc_param_id2, static_cast<uint16_t>(paramEnvAttack->get()));
         } else if (id == "env_decay") {
-            OSC_PARAM(k_user_osc_param_id3, static_cast<uint16_t>(paramEnvDecay->get() + 100));
+            paramQueue.push(k_user_osc_param_id3, static_cast<uint16_t>(paramEnvDecay->get() + 100));
         } else if (id == "env_amount") {
-            OSC_PARAM(k_user_osc_param_id4, static_cast<uint16_t>(paramEnvAmount->get() + 100));
+            paramQueue.push(k_user_osc_param_id4, static_cast<uint16_t>(paramEnvAmount->get() + 100));
         } else if (id == "lfo_rate") {
-            OSC_PARAM(k_user_osc_param_id5, static_cast<uint16_t>(paramLfoRate->get()));
+            paramQueue.push(k_user_osc_param_id5, static_cast<uint16_t>(paramLfoRate->get()));
         } else if (id == "lfo_amount") {
-            OSC_PARAM(k_user_osc_param_id6, static_cast<uint16_t>(paramLfoAmount->get()));
+            paramQueue.push(k_user_osc_param_id6, static_cast<uint16_t>(paramLfoAmount->get()));
+        } else if (id == "lfo_shape") {
+            paramQueue.push(k_wvt_param_lfo_shape, static_cast<uint16_t>(paramLfoShape->getIndex()));
+        } else if (id == "lfo_free") {
+            paramQueue.push(k_wvt_param_lfo_free, paramLfoFree->get() ? 1 : 0);
+        } else if (id == "lfo_delay") {
+            paramQueue.push(k_wvt_param_lfo_delay, static_cast<uint16_t>(paramLfoDelay->get()));
+        } else if (id == "glide") {
+            paramQueue.push(k_wvt_param_glide, static_cast<uint16_t>(paramGlide->get()));
+        } else if (id == "ovs") {
+            paramQueue.push(k_wvt_param_ovs, static_cast<uint16_t>(paramOvs->getIndex()));
         }
     }
 
 private:
+    // Set an oscillator parameter in all voices (audio thread)
+    void setOscParam(uint16_t index, uint16_t value)
+    {
+        for (auto i = 0; i < synth.getNumVoices(); ++i) {
+            if (auto* voice = dynamic_cast<SynthVoice*>(synth.getVoice(i)))
+                voice->setOscParam(index, value);
+        }
+    }
+
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
     {
         juce::AudioProcessorValueTreeState::ParameterLayout layout;
@@ -306,6 +468,13 @@ private:
         layout.add(std::make_unique<juce::AudioParameterInt>("env_amount", "Env Amount", -99, 100, 0));
         layout.add(std::make_unique<juce::AudioParameterInt>("lfo_rate", "LFO2 Rate", 0, 100, 0));
         layout.add(std::make_unique<juce::AudioParameterInt>("lfo_amount", "LFO2 Amount", 0, 100, 0));
+        layout.add(std::make_unique<juce::AudioParameterChoice>("lfo_shape", "LFO2 Shape",
+            juce::StringArray { "Triangle", "Sine", "Saw", "Square", "S&H" }, 0));
+        layout.add(std::make_unique<juce::AudioParameterBool>("lfo_free", "LFO2 Free Run", false));
+        layout.add(std::make_unique<juce::AudioParameterInt>("lfo_delay", "LFO2 Delay", 0, 100, 0));
+        layout.add(std::make_unique<juce::AudioParameterInt>("glide", "Glide", 0, 100, 0));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(
+            "ovs", "Oversampling", juce::StringArray { "1x", "2x", "4x", "8x", "Auto" }, OVS_DEFAULT_LOG2));
 
         layout.add(std::make_unique<juce::AudioParameterFloat>(
             "release", "Release", juce::NormalisableRange<float>(0.f, 3.f, 0.05f, 0.5f), 0.5f));
@@ -317,6 +486,8 @@ private:
 
     juce::Synthesiser synth;
     juce::AudioProcessorValueTreeState state;
+    ParamQueue paramQueue;
+    juce::MidiBuffer segmentMidi; // MIDI events of a segment between the parameter changes
 
     juce::AudioParameterInt* paramWave;
     juce::AudioParameterInt* paramSkew;
@@ -326,6 +497,11 @@ private:
     juce::AudioParameterInt* paramEnvAmount;
     juce::AudioParameterInt* paramLfoRate;
     juce::AudioParameterInt* paramLfoAmount;
+    juce::AudioParameterChoice* paramLfoShape;
+    juce::AudioParameterBool* paramLfoFree;
+    juce::AudioParameterInt* paramLfoDelay;
+    juce::AudioParameterInt* paramGlide;
+    juce::AudioParameterChoice* paramOvs;
     juce::AudioParameterFloat* paramRelease;
     juce::AudioParameterFloat* paramGain;
 
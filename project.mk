@@ -4,16 +4,39 @@
 
 PROJECT = WvTable
 
-UCSRC = ../src/wtdef.c ../src/WvTable.c
+UCSRC = ../src/wtdef.c ../src/wvtvoice.c ../src/WvTable.c
 
 UCXXSRC = 
 
-UHEADERS = wtgen.h wtdef.h envlfo.h decimator.h compat.h
+UHEADERS = wvtvoice.h wtgen.h wtdef.h envlfo.h decimator.h compat.h
 
 UINCDIR =
 
 UDEFS =
 
+# Build options, set in the platform Makefile or on the command line
+# (e.g. make install WTGEN_UNFOLD=1). See README.md for the memory cost.
+# WTGEN_UNFOLD=1: keep the waves of the current wavetable unfolded in RAM
+ifeq ($(WTGEN_UNFOLD),1)
+UDEFS += -DWTGEN_UNFOLD
+endif
+# OVS_AUTO=1: oversampling factor selected from the pitch (1x for low notes)
+ifeq ($(OVS_AUTO),1)
+UDEFS += -DOVS_AUTO
+endif
+# WTGEN_Q15=1: fixed point generator and decimator (Cortex-M4 DSP instructions)
+ifeq ($(WTGEN_Q15),1)
+UDEFS += -DWTGEN_Q15
+endif
+# WTGEN_SMOOTH=1: wave number ramped on every sample instead of once per block
+ifeq ($(WTGEN_SMOOTH),1)
+UDEFS += -DWTGEN_SMOOTH
+endif
+# MOD_BLOCK_RATE=1: wave envelope and LFO2 applied once per 32 samples instead of every 8 samples
+ifeq ($(MOD_BLOCK_RATE),1)
+UDEFS += -DMOD_STRIDE=GEN_BLOCK
+endif
+
 ULIB = 
 
 ULIBDIR =
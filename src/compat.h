@@ -8,6 +8,8 @@
     but before any custom headers.
 */
 
+#include <stdint.h>
+
 #ifndef NO_FORCE_INLINE
 #if defined(__GNUC__)
 #ifndef __clang__
@@ -21,15 +23,37 @@
 #define _INLINE static inline
 #endif // #ifdef __GNUC__
 #else // #ifndef NO_FORCE_INLINE
-#define _INLINE
+// static: the headers are included by more than one source file
+#define _INLINE static inline
 #endif // #ifndef NO_FORCE_INLINE
 
+// never inlined: a wrapper, so that a large inline function is expanded only once
+#if defined(__GNUC__)
+#define _NOINLINE static __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define _NOINLINE static __declspec(noinline)
+#else
+#define _NOINLINE static
+#endif
+
 /*
     Fixed math Q types
 */
 
 // 32-bit types
-typedef long q7_24_t; // Q7.24 signed
-typedef unsigned long uq7_25_t; // Q7.25 unsigned
+// (fixed width: the phase accumulators rely on the 32-bit wrap-around,
+// and long is 64-bit on LP64 hosts)
+typedef int32_t q7_24_t; // Q7.24 signed
+typedef uint32_t uq7_25_t; // Q7.25 unsigned
+
+/*
+    Samples passed from the generator to the decimator.
+    WTGEN_Q15: fixed point, int32 scaled by 2**20 (see wtgen.h), otherwise float.
+*/
+#ifdef WTGEN_Q15
+typedef int32_t wtsample_t;
+#else
+typedef float wtsample_t;
+#endif
 
 #endif
@@ -14,14 +14,37 @@
 
 #include "compat.h"
 
+// SIMD version of decimator_process_block, desktop builds
+#if defined(WTGEN_Q15)
+// fixed point version, no SIMD
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DECIMATOR_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DECIMATOR_NEON
+#endif
+
 // Coefficients of the polyphase filter
 #define NC_DSMPL 8
-const float DSMPL_COEF[NC_DSMPL] = { 0.0771150798324162f, 0.2659685265210946f, 0.4820706250610472f, 0.6651041532634957f,
+static const float DSMPL_COEF[NC_DSMPL] = { 0.0771150798324162f, 0.2659685265210946f, 0.4820706250610472f, 0.6651041532634957f,
     0.7968204713315797f, 0.8841015085506159f, 0.9412514277740471f, 0.9820054141886075f };
 
+#ifdef WTGEN_Q15
+// Coefficients in Q31, for the fixed point version (WTGEN_Q15).
+// A filter section is a single SMMLA: s + ((2 * (x - s2) * c) >> 32),
+// the samples need 2 bits of headroom (the generator output uses 28 bits).
+// smmla comes from the logue SDK (utils/cortexm4.h) or from userosc2.h.
+static const int32_t DSMPL_COEF_Q31[NC_DSMPL] = { 165603373, 571163062, 1035238784, 1428300293,
+    1711158933, 1898593533, 2021322050, 2108840569 };
+#define DSMPL_SECTION(x, s2, p, s0) ((int32_t)smmla(((x) - (s2)) * 2, DSMPL_COEF_Q31[p], (s0)))
+#else
+#define DSMPL_SECTION(x, s2, p, s0) (((x) - (s2)) * DSMPL_COEF[p] + (s0))
+#endif
+
 // Decimator state
 typedef struct {
-    float s[NC_DSMPL + 2];
+    wtsample_t s[NC_DSMPL + 2];
 } DecimatorState;
 
 /*  decimator_reset
@@ -40,27 +63,164 @@ _INLINE void decimator_reset(DecimatorState* __restrict state)
     x2: second input sample
     Returns: decimated output sample
 */
-_INLINE float decimator_do(DecimatorState* __restrict state, float x1, float x2)
+_INLINE wtsample_t decimator_do(DecimatorState* __restrict state, wtsample_t x1, wtsample_t x2)
 {
-    float aIn = x2;
-    float bIn = x1;
-    float aOut, bOut;
+    wtsample_t aIn = x2;
+    wtsample_t bIn = x1;
+    wtsample_t aOut, bOut;
     int p;
     for (p = 0; p < NC_DSMPL;) {
         // upper branch
-        aOut = (aIn - state->s[p + 2]) * DSMPL_COEF[p] + state->s[p];
+        aOut = DSMPL_SECTION(aIn, state->s[p + 2], p, state->s[p]);
         state->s[p] = aIn;
         aIn = aOut;
         p++;
         // lower branch
-        bOut = (bIn - state->s[p + 2]) * DSMPL_COEF[p] + state->s[p];
+        bOut = DSMPL_SECTION(bIn, state->s[p + 2], p, state->s[p]);
         state->s[p] = bIn;
         bIn = bOut;
         p++;
     }
     state->s[p] = aOut;
     state->s[p + 1] = bOut;
+#ifdef WTGEN_Q15
+    return (aOut + bOut) >> 1;
+#else
     return 0.5f * (aOut + bOut);
+#endif
+}
+
+/*  decimator_process_block
+    Decimate a block of samples.
+    The filter state is kept in registers for the whole block. On desktop builds,
+    the upper and the lower branch are computed in two SIMD lanes (SSE or NEON).
+    The result is the same as from decimator_do called for each pair of samples.
+    in: input samples, 2 * n
+    out: output samples, n; may be the same buffer as in
+    n: number of output samples
+*/
+_INLINE void decimator_process_block(DecimatorState* __restrict state, const wtsample_t* in, wtsample_t* out, uint32_t n)
+{
+    uint32_t i;
+#if defined(DECIMATOR_SSE)
+    // lane 0: lower branch (odd coefficients), lane 1: upper branch (even coefficients),
+    // so that the input pairs may be loaded directly
+    // (through __m64, which may alias float: no access of the float arrays as double)
+#define DSMPL_LOAD2(p) _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(p))
+#define DSMPL_STORE2(p, v) _mm_storel_pi((__m64*)(p), v)
+#define DSMPL_SWAP(v) _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 2, 0, 1))
+    __m128 x0 = DSMPL_SWAP(DSMPL_LOAD2(&state->s[0]));
+    __m128 x1 = DSMPL_SWAP(DSMPL_LOAD2(&state->s[2]));
+    __m128 x2 = DSMPL_SWAP(DSMPL_LOAD2(&state->s[4]));
+    __m128 x3 = DSMPL_SWAP(DSMPL_LOAD2(&state->s[6]));
+    __m128 x4 = DSMPL_SWAP(DSMPL_LOAD2(&state->s[8]));
+    const __m128 c0 = DSMPL_SWAP(DSMPL_LOAD2(&DSMPL_COEF[0]));
+    const __m128 c1 = DSMPL_SWAP(DSMPL_LOAD2(&DSMPL_COEF[2]));
+    const __m128 c2 = DSMPL_SWAP(DSMPL_LOAD2(&DSMPL_COEF[4]));
+    const __m128 c3 = DSMPL_SWAP(DSMPL_LOAD2(&DSMPL_COEF[6]));
+    for (i = 0; i < n; i++) {
+        __m128 v = DSMPL_LOAD2(&in[2 * i]);
+        __m128 y;
+        y = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(v, x1), c0), x0);
+        x0 = v;
+        v = y;
+        y = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(v, x2), c1), x1);
+        x1 = v;
+        v = y;
+        y = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(v, x3), c2), x2);
+        x2 = v;
+        v = y;
+        y = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(v, x4), c3), x3);
+        x3 = v;
+        x4 = y;
+        out[i] = 0.5f * (_mm_cvtss_f32(y) + _mm_cvtss_f32(_mm_shuffle_ps(y, y, 1)));
+    }
+    DSMPL_STORE2(&state->s[0], DSMPL_SWAP(x0));
+    DSMPL_STORE2(&state->s[2], DSMPL_SWAP(x1));
+    DSMPL_STORE2(&state->s[4], DSMPL_SWAP(x2));
+    DSMPL_STORE2(&state->s[6], DSMPL_SWAP(x3));
+    DSMPL_STORE2(&state->s[8], DSMPL_SWAP(x4));
+#undef DSMPL_LOAD2
+#undef DSMPL_STORE2
+#undef DSMPL_SWAP
+#elif defined(DECIMATOR_NEON)
+    // lane 0: lower branch, lane 1: upper branch, as above
+    float32x2_t x0 = vrev64_f32(vld1_f32(&state->s[0]));
+    float32x2_t x1 = vrev64_f32(vld1_f32(&state->s[2]));
+    float32x2_t x2 = vrev64_f32(vld1_f32(&state->s[4]));
+    float32x2_t x3 = vrev64_f32(vld1_f32(&state->s[6]));
+    float32x2_t x4 = vrev64_f32(vld1_f32(&state->s[8]));
+    const float32x2_t c0 = vrev64_f32(vld1_f32(&DSMPL_COEF[0]));
+    const float32x2_t c1 = vrev64_f32(vld1_f32(&DSMPL_COEF[2]));
+    const float32x2_t c2 = vrev64_f32(vld1_f32(&DSMPL_COEF[4]));
+    const float32x2_t c3 = vrev64_f32(vld1_f32(&DSMPL_COEF[6]));
+    for (i = 0; i < n; i++) {
+        float32x2_t v = vld1_f32(&in[2 * i]);
+        float32x2_t y;
+        y = vadd_f32(vmul_f32(vsub_f32(v, x1), c0), x0);
+        x0 = v;
+        v = y;
+        y = vadd_f32(vmul_f32(vsub_f32(v, x2), c1), x1);
+        x1 = v;
+        v = y;
+        y = vadd_f32(vmul_f32(vsub_f32(v, x3), c2), x2);
+        x2 = v;
+        v = y;
+        y = vadd_f32(vmul_f32(vsub_f32(v, x4), c3), x3);
+        x3 = v;
+        x4 = y;
+        out[i] = 0.5f * (vget_lane_f32(y, 0) + vget_lane_f32(y, 1));
+    }
+    vst1_f32(&state->s[0], vrev64_f32(x0));
+    vst1_f32(&state->s[2], vrev64_f32(x1));
+    vst1_f32(&state->s[4], vrev64_f32(x2));
+    vst1_f32(&state->s[6], vrev64_f32(x3));
+    vst1_f32(&state->s[8], vrev64_f32(x4));
+#else
+    wtsample_t s[NC_DSMPL + 2];
+    wtsample_t aOut = 0, bOut = 0;
+    int p;
+    for (p = 0; p < NC_DSMPL + 2; p++)
+        s[p] = state->s[p];
+    for (i = 0; i < n; i++) {
+        wtsample_t aIn = in[2 * i + 1];
+        wtsample_t bIn = in[2 * i];
+        for (p = 0; p < NC_DSMPL;) {
+            // upper branch
+            aOut = DSMPL_SECTION(aIn, s[p + 2], p, s[p]);
+            s[p] = aIn;
+            aIn = aOut;
+            p++;
+            // lower branch
+            bOut = DSMPL_SECTION(bIn, s[p + 2], p, s[p]);
+            s[p] = bIn;
+            bIn = bOut;
+            p++;
+        }
+        s[p] = aOut;
+        s[p + 1] = bOut;
+#ifdef WTGEN_Q15
+        out[i] = (aOut + bOut) >> 1;
+#else
+        out[i] = 0.5f * (aOut + bOut);
+#endif
+    }
+    for (p = 0; p < NC_DSMPL + 2; p++)
+        state->s[p] = s[p];
+#endif
+}
+
+/*  decimator_cascade
+    Decimate a block of samples by 2**nstages, in place, with a cascade of halfband stages.
+    stages: filter states, stages[k] decimates from 2**(k+1) to 2**k times the output rate
+    buf: input samples (n << nstages), the output samples are written at the beginning
+    n: number of output samples
+    nstages: number of stages, 0: no decimation
+*/
+_INLINE void decimator_cascade(DecimatorState* stages, wtsample_t* buf, uint32_t n, uint8_t nstages)
+{
+    while (nstages--)
+        decimator_process_block(&stages[nstages], buf, buf, n << nstages);
 }
 
 #endif
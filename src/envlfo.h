@@ -5,7 +5,8 @@
 /*
  * envlfo
  * Simple Attack-Decay or Attack-Sustain-Release envelope,
- * combined with a triangular LFO.
+ * combined with an LFO (triangle, sine, saw, square or sample & hold),
+ * key-synced or free-running, with a fade-in delay.
  * Intended for wavetable index modulation.
  * Author: Grzegorz Szwoch (GregVuki)
  */
@@ -18,6 +19,16 @@
 
 typedef enum { ENV_IDLE, ENV_A, ENV_D, ENV_S } EnvStage;
 
+// LFO wave shapes
+typedef enum {
+    LFO_TRIANGLE, // triangle (default)
+    LFO_SINE, // sine, approximated from the triangle
+    LFO_SAW, // rising sawtooth
+    LFO_SQUARE, // square
+    LFO_SAMPLE_HOLD, // random value, changed once per period
+    LFO_NUM_SHAPES
+} LfoShape;
+
 typedef struct {
     EnvStage stage; // current envelope stage
     q7_24_t out_val; // last computed output value, Q7.24
@@ -27,11 +38,17 @@ typedef struct {
     int32_t sus_val; // envelope value in sustain state, Q7.24
     uint32_t lfo_phase; // LFO phase
     uint32_t lfo_step; // LFO phase step
+    uint32_t lfo_fade; // LFO fade-in gain, UQ1.31, FIXED_ONE after the delay
+    uint32_t lfo_fade_rate; // LFO fade-in rate, FIXED_ONE: no delay
+    uint32_t lfo_rand; // random generator state, for the sample & hold
+    int32_t lfo_sh; // sample & hold value, Q30
     float sample_rate; // sampling rate, used to compute envelope duration
     int8_t env_amount; // envelope amount (modulation depth)
     int8_t lfo_amount; // LFO amount (modulation depth)
     int8_t decay_scale; // envelope scaler for the decay/release stage
     int8_t hold; // if 1, hold the envelope after the attack, until note off
+    uint8_t lfo_shape; // LFO shape (LfoShape)
+    uint8_t lfo_free; // if 1, the LFO phase is not reset on note on
 } EnvLfoState;
 
 /*  envlfo_init
@@ -48,22 +65,48 @@ _INLINE void envlfo_init(EnvLfoState* state, float srate)
     state->sus_val = 0;
     state->lfo_phase = TRI_SHIFT;
     state->lfo_step = 0;
+    state->lfo_fade = FIXED_ONE;
+    state->lfo_fade_rate = FIXED_ONE;
+    state->lfo_rand = 0x9E3779B9U; // any nonzero seed
+    state->lfo_sh = 0;
     state->sample_rate = srate;
     state->env_amount = 0;
     state->lfo_amount = 0;
     state->decay_scale = 0;
     state->hold = 0;
+    state->lfo_shape = LFO_TRIANGLE;
+    state->lfo_free = 0;
+}
+
+/*  lfo_random
+    Generate the next sample & hold value (xorshift32).
+    Returns: random value, Q30 (-1..1)
+*/
+_INLINE int32_t lfo_random(EnvLfoState* state)
+{
+    uint32_t x = state->lfo_rand;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state->lfo_rand = x;
+    return (int32_t)x >> 1;
 }
 
 /*  envlfo_reset
-    Reset the envelope state
+    Reset the envelope state.
+    The LFO phase is reset only in the key sync mode, the delay starts again.
 */
 _INLINE void envlfo_reset(EnvLfoState* state)
 {
     state->stage = ENV_IDLE;
     state->env_val = 0;
     state->out_val = 0;
-    state->lfo_phase = TRI_SHIFT; // start the triangle wave LFO going up
+    if (!state->lfo_free) {
+        state->lfo_phase = TRI_SHIFT; // start the triangle wave LFO going up
+        if (state->lfo_shape == LFO_SAMPLE_HOLD)
+            state->lfo_sh = lfo_random(state);
+    }
+    state->lfo_fade = (state->lfo_fade_rate < FIXED_ONE) ? 0 : FIXED_ONE;
 }
 
 /*
@@ -166,6 +209,46 @@ _INLINE void envlfo_set_lfo_rate(EnvLfoState* state, uint32_t rate)
     state->lfo_step = rate;
 }
 
+/*  envlfo_set_lfo_shape
+    Set the LFO wave shape.
+    shape: LfoShape value, out of range values select the triangle
+*/
+_INLINE void envlfo_set_lfo_shape(EnvLfoState* state, uint8_t shape)
+{
+    state->lfo_shape = (shape < LFO_NUM_SHAPES) ? shape : LFO_TRIANGLE;
+}
+
+/*  envlfo_set_lfo_free
+    Set the LFO phase mode.
+    free == 0: key sync, the LFO starts from the same phase on each note on
+    free == 1: free run, the LFO continues from the last phase
+*/
+_INLINE void envlfo_set_lfo_free(EnvLfoState* state, uint8_t free)
+{
+    state->lfo_free = free;
+}
+
+/*  envlfo_set_lfo_delay
+    Set the LFO delay: the LFO amount rises linearly from zero after the LFO becomes active.
+    dtime: delay time in seconds, 0: no delay
+*/
+_INLINE void envlfo_set_lfo_delay(EnvLfoState* state, float dtime)
+{
+    if (dtime > 1e-6)
+        state->lfo_fade_rate = (uint32_t)((float)FIXED_ONE / (state->sample_rate * dtime) + 0.5f);
+    else
+        state->lfo_fade_rate = FIXED_ONE;
+}
+
+/*  envlfo_set_lfo_delay_rate
+    Set the LFO delay as the fade-in rate.
+    rate: fade-in rate (Q31), FIXED_ONE: no delay
+*/
+_INLINE void envlfo_set_lfo_delay_rate(EnvLfoState* state, uint32_t rate)
+{
+    state->lfo_fade_rate = rate;
+}
+
 /*
     Signal generation
     -----------------
@@ -207,6 +290,84 @@ _INLINE void envlfo_note_off(EnvLfoState* state)
     }
 }
 
+/*  lfo_tri
+    Calculate the triangle LFO value at the phase: 2 * abs(phase) - 1.
+    All the other shapes (except the sample & hold) are derived from the triangle.
+    Returns: the LFO value, Q30 (-1..1)
+*/
+_INLINE int32_t lfo_tri(uint32_t phase)
+{
+    const int32_t x = (int32_t)phase;
+    const int32_t mask = x >> 31;
+    return (x ^ mask) - mask - (int32_t)TRI_SHIFT;
+}
+
+/*  lfo_sine
+    Calculate the sine LFO value at the phase.
+    Parabola y = tri * (2 - abs(tri)), corrected with y + P * (y * abs(y) - y),
+    P = 29/128 computed with shifts: one correction multiply, error below 0.0014.
+    Returns: the LFO value, Q30 (-1..1)
+*/
+_INLINE int32_t lfo_sine(uint32_t phase)
+{
+    const int32_t tri = lfo_tri(phase);
+    const int32_t tmask = tri >> 31;
+    const int32_t y = (int32_t)(((int64_t)tri * (int64_t)(FIXED_ONE - (uint32_t)((tri ^ tmask) - tmask))) >> 30);
+    const int32_t ymask = y >> 31;
+    const int32_t d = (int32_t)(((int64_t)y * ((y ^ ymask) - ymask)) >> 30) - y;
+    return y + (d >> 3) + (d >> 4) + (d >> 5) + (d >> 7);
+}
+
+/*  lfo_saw
+    Calculate the saw LFO value at the phase, zero at the start phase (TRI_SHIFT), as the triangle.
+    Returns: the LFO value, Q30 (-1..1)
+*/
+_INLINE int32_t lfo_saw(uint32_t phase)
+{
+    return (int32_t)(phase - TRI_SHIFT) >> 1;
+}
+
+/*  lfo_square
+    Calculate the square LFO value at the phase, the sign of the triangle.
+    Returns: the LFO value, Q30 (-1..1)
+*/
+_INLINE int32_t lfo_square(uint32_t phase)
+{
+    return (lfo_tri(phase) >= 0) ? (int32_t)TRI_SHIFT : -(int32_t)TRI_SHIFT;
+}
+
+/*  lfo_value
+    Calculate the LFO value of the current shape at the phase.
+    Returns: the LFO value, Q30 (-1..1)
+*/
+_INLINE int32_t lfo_value(const EnvLfoState* state, uint32_t phase)
+{
+    switch (state->lfo_shape) {
+    case LFO_SINE:
+        return lfo_sine(phase);
+    case LFO_SAW:
+        return lfo_saw(phase);
+    case LFO_SQUARE:
+        return lfo_square(phase);
+    case LFO_SAMPLE_HOLD:
+        return state->lfo_sh;
+    default:
+        return lfo_tri(phase);
+    }
+}
+
+/*  lfo_advance
+    Advance the LFO phase.
+    In the sample & hold shape, draw a new value at the end of the period.
+*/
+_INLINE void lfo_advance(EnvLfoState* state, uint32_t inc)
+{
+    const uint32_t phase = state->lfo_phase + inc;
+    if ((state->lfo_shape == LFO_SAMPLE_HOLD) && (phase < state->lfo_phase))
+        state->lfo_sh = lfo_random(state);
+    state->lfo_phase = phase;
+}
+
 /*  envlfo_get
     Generate and return the envelope + LFO value.
     steps: before generating the value, advance the phase by this number of samples.
@@ -249,20 +410,25 @@ _INLINE q7_24_t envlfo_get(EnvLfoState* state, uint32_t steps)
             state->sus_val = 0;
             state->out_val = 0;
             // if we are at zero, start the triangle wave LFO going down - shift the initial phase
-            state->lfo_phase += TRI_SHIFT << 1;
+            if (!state->lfo_free)
+                state->lfo_phase += TRI_SHIFT << 1;
         } else {
             state->out_val = (q7_24_t)(state->env_val >> 7) * state->decay_scale;
         }
         break;
     case ENV_S: {
         // in the sustain stage - the LFO is active
-        // calculate the LFO value: 2 * abs(phase) - 1
-        const int32_t x = (int32_t)(state->lfo_phase);
-        const int32_t mask = x >> 31;
-        const int32_t lfo_val = (x ^ mask) - mask - (int32_t)TRI_SHIFT; // value in Q30
-        state->lfo_phase += state->lfo_step * steps;
+        const int32_t lfo_val = lfo_value(state, state->lfo_phase); // value in Q30
+        lfo_advance(state, state->lfo_step * steps);
         // scale the LFO value and add it to the envelope sustain value
-        state->out_val = state->sus_val + (lfo_val >> 6) * state->lfo_amount;
+        int32_t lfo_out = (lfo_val >> 6) * state->lfo_amount;
+        if (state->lfo_fade < FIXED_ONE) {
+            // delay: fade in
+            const uint32_t inc = state->lfo_fade_rate * steps;
+            lfo_out = (int32_t)(((int64_t)lfo_out * state->lfo_fade) >> 31);
+            state->lfo_fade = (inc < FIXED_ONE - state->lfo_fade) ? state->lfo_fade + inc : FIXED_ONE;
+        }
+        state->out_val = state->sus_val + lfo_out;
     } break;
     default:
         // in the idle stage - the envelope and the LFO are inactive
@@ -271,4 +437,98 @@ _INLINE q7_24_t envlfo_get(EnvLfoState* state, uint32_t steps)
     return state->out_val;
 }
 
+/*  envlfo_render
+    Generate n values of the envelope + LFO, one every stride samples,
+    the same as n calls of envlfo_get(state, stride).
+    The number of values before the next stage transition is calculated in advance,
+    the values within a stage are generated without checking the stage,
+    the value with the transition is generated by envlfo_get.
+    out: output buffer, n values, Q7.24 (-128..127)
+    stride: number of samples between the values
+*/
+_INLINE void envlfo_render(EnvLfoState* state, q7_24_t* __restrict out, uint32_t n, uint32_t stride)
+{
+    q7_24_t* const out_e = out + n;
+    while (out != out_e) {
+        const uint32_t left = (uint32_t)(out_e - out);
+        uint32_t k = left; // number of values before the stage transition
+        uint32_t i;
+        switch (state->stage) {
+        case ENV_A: {
+            const uint32_t inc = state->arate * stride;
+            const int32_t amount = state->env_amount;
+            uint32_t env_val = state->env_val;
+            if (inc >= FIXED_ONE)
+                k = 0;
+            else if (inc && ((FIXED_ONE - 1 - env_val) / inc < left))
+                k = (FIXED_ONE - 1 - env_val) / inc;
+            for (i = 0; i < k; i++) {
+                env_val += inc;
+                *(out++) = (q7_24_t)(env_val >> 7) * amount;
+            }
+            state->env_val = env_val;
+        } break;
+        case ENV_D: {
+            const uint32_t inc = state->drate * stride;
+            const int32_t amount = state->decay_scale;
+            uint32_t env_val = state->env_val;
+            if ((inc >= FIXED_ONE) || (!inc && (env_val & FIXED_ONE)))
+                k = 0; // (the decay from 1 with rate 0 ends immediately)
+            else if (inc && (env_val / inc < left))
+                k = env_val / inc;
+            for (i = 0; i < k; i++) {
+                env_val -= inc;
+                *(out++) = (q7_24_t)(env_val >> 7) * amount;
+            }
+            state->env_val = env_val;
+        } break;
+        case ENV_S: {
+            // no transition (until note off), the delay fade-in is generated by envlfo_get
+            // one loop per shape, the LFO value (Q30) is taken before the step
+            const uint32_t inc = state->lfo_step * stride;
+            const int32_t sus_val = state->sus_val;
+            const int32_t amount = state->lfo_amount;
+            uint32_t phase = state->lfo_phase;
+            if (state->lfo_fade < FIXED_ONE)
+                k = 0;
+            switch (state->lfo_shape) {
+            case LFO_SINE:
+                for (i = 0; i < k; i++, phase += inc)
+                    *(out++) = sus_val + (lfo_sine(phase) >> 6) * amount;
+                break;
+            case LFO_SAW:
+                for (i = 0; i < k; i++, phase += inc)
+                    *(out++) = sus_val + (lfo_saw(phase) >> 6) * amount;
+                break;
+            case LFO_SQUARE:
+                for (i = 0; i < k; i++, phase += inc)
+                    *(out++) = sus_val + (lfo_square(phase) >> 6) * amount;
+                break;
+            case LFO_SAMPLE_HOLD: {
+                int32_t sh = state->lfo_sh;
+                for (i = 0; i < k; i++) {
+                    *(out++) = sus_val + (sh >> 6) * amount;
+                    if (phase + inc < phase)
+                        sh = lfo_random(state); // end of the period
+                    phase += inc;
+                }
+                state->lfo_sh = sh;
+            } break;
+            default:
+                for (i = 0; i < k; i++, phase += inc)
+                    *(out++) = sus_val + (lfo_tri(phase) >> 6) * amount;
+            }
+            state->lfo_phase = phase;
+        } break;
+        default:
+            for (i = 0; i < k; i++)
+                *(out++) = 0;
+        }
+        if (k)
+            state->out_val = out[-1];
+        if (k < left)
+            *(out++) = envlfo_get(state, stride); // stage transition
+    }
+}
+
 #endif
@@ -20,6 +20,10 @@ extern "C" {
 #define k_note_max_hz (23679.643054f)
 #define k_samplerate (48000)
 #define k_samplerate_recipf (2.08333333333333e-005f)
+#define k_midi_to_hz_size (152)
+
+    // note to frequency LUT, the same as in the logue firmware (defined in wvtvoice.c)
+    extern const float midi_to_hz_lut_f[k_midi_to_hz_size];
 
     typedef uint32_t q31_t;
 
@@ -83,10 +87,29 @@ extern "C" {
      */
     __fast_inline float osc_notehzf(uint8_t note)
     {
-        // return midi_to_hz_lut_f[clipmaxu32(note,k_midi_to_hz_size-1)];
-        return 440.f * powf(2.f, (note - 69.f) * 0.08333333333333333f);
+        return midi_to_hz_lut_f[(note < k_midi_to_hz_size) ? note : k_midi_to_hz_size - 1];
     }
 
+    /**
+     * Cortex-M4 DSP instructions (utils/cortexm4.h in the logue SDK), portable versions
+     */
+    __fast_inline uint32_t smuad(uint32_t op1, uint32_t op2)
+    {
+        return (uint32_t)((int32_t)(int16_t)op1 * (int16_t)op2 + (int32_t)(int16_t)(op1 >> 16) * (int16_t)(op2 >> 16));
+    }
+
+    __fast_inline uint32_t smlad(uint32_t op1, uint32_t op2, uint32_t op3)
+    {
+        return smuad(op1, op2) + op3;
+    }
+
+    __fast_inline uint32_t smmla(int32_t op1, int32_t op2, int32_t op3)
+    {
+        return (uint32_t)(op3 + (int32_t)(((int64_t)op1 * op2) >> 32));
+    }
+
+#define pkhbt(ARG1, ARG2, ARG3) ((((uint32_t)(ARG1)) & 0x0000FFFFUL) | ((((uint32_t)(ARG2)) << (ARG3)) & 0xFFFF0000UL))
+
     // Callbacks
     void OSC_INIT(uint32_t platform, uint32_t api);
     void OSC_CYCLE(const user_osc_param_t* const params, int32_t* framebuf, const uint32_t nframes);
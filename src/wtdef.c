@@ -971,4 +971,79 @@ const float WSCALER[32] = { 1.0f, 0.5f, 0.3333333333333333f, 0.25f, 0.2f, 0.1666
  */
 const unsigned char WT28_SPAN[] = { 128, 118, 110, 102, 96, 90, 85, 80, 76, 73, 69, 66, 64, 61, 59, 56, 54, 53, 51, 49,
     48, 46, 45, 44, 42, 41, 40, 39, 38, 37, 36, 35, 35, 34, 33, 32, 32, 31, 31, 30, 29, 29, 28, 28, 27, 27, 26, 26, 25,
-    25, 25, 24, 24, 24, 23, 23, 23, 22, 22, 22, 21 };
\ No newline at end of file
+    25, 25, 24, 24, 24, 23, 23, 23, 22, 22, 22, 21 };
+/*
+ * minBLEP residual (minimum phase band-limited step - 1), for wavetable 29 (step).
+ * Blackman windowed sinc (8 zero crossings per side, cutoff at the Nyquist frequency),
+ * minimum phase by the cepstrum method, integrated and normalized to 1,
+ * faded out over the last 2 samples.
+ * Row: time from the step to the first sample, in 1/BLEP_PHASES sample units (0..BLEP_PHASES).
+ * Column: sample after the step.
+ */
+const float MINBLEP[BLEP_PHASES + 1][BLEP_LEN] = {
+    { -1.0f, -0.9927813f, -0.7523175f, 0.02345553f, 0.07799646f, -0.07461403f, 0.05451166f, -0.03549322f,
+        0.02071635f, -0.01098506f, 0.004947626f, -0.00192806f, 0.0006189775f, -0.0001269321f, -2.817626e-06f, 5.706496e-06f },
+    { -0.9999999f, -0.9915157f, -0.734303f, 0.04377283f, 0.06513525f, -0.06774098f, 0.05091379f, -0.03360546f,
+        0.01971463f, -0.0104466f, 0.004658624f, -0.001773704f, 0.0005443611f, -9.741839e-05f, -1.030979e-05f, 5.337971e-06f },
+    { -0.9999998f, -0.9900737f, -0.7155154f, 0.0630573f, 0.05218759f, -0.06050527f, 0.04697294f, -0.03146959f,
+        0.01855996f, -0.0098271f, 0.004334002f, -0.001607546f, 0.0004677204f, -6.866136e-05f, -1.69123e-05f, 4.884951e-06f },
+    { -0.9999995f, -0.9884372f, -0.6959646f, 0.08125041f, 0.03924393f, -0.05297378f, 0.04273266f, -0.02911291f,
+        0.01726895f, -0.009136207f, 0.003979002f, -0.001432153f, 0.0003901327f, -4.100784e-05f, -2.25622e-05f, 4.379071e-06f },
+    { -0.9999989f, -0.9865873f, -0.6756642f, 0.09829808f, 0.02639321f, -0.04521438f, 0.03823811f, -0.02656399f,
+        0.01585896f, -0.008383939f, 0.003598959f, -0.001250066f, 0.0003126248f, -1.476728e-05f, -2.722193e-05f, 3.848589e-06f },
+    { -0.9999979f, -0.9845038f, -0.6546317f, 0.114151f, 0.0137222f, -0.03729535f, 0.03353556f, -0.02385239f,
+        0.01434796f, -0.00758055f, 0.003199235f, -0.001063771f, 0.0002361631f, 9.790353e-06f, -3.087864e-05f, 3.317761e-06f },
+    { -0.9999961f, -0.9821656f, -0.6328886f, 0.1287651f, 0.00131499f, -0.02928484f, 0.02867201f, -0.02100834f,
+        0.01275432f, -0.00673641f, 0.002785158f, -0.0008756747f, 0.0001616443f, 3.243588e-05f, -3.354293e-05f, 2.806458e-06f },
+    { -0.9999932f, -0.9795507f, -0.6104605f, 0.1421017f, -0.0107476f, -0.0212503f, 0.02369471f, -0.01806245f,
+        0.01109656f, -0.005861898f, 0.002361968f, -0.0006880762f, 8.98883e-05f, 5.298173e-05f, -3.524711e-05f, 2.330005e-06f },
+    { -0.9999887f, -0.9766362f, -0.5873769f, 0.1541281f, -0.0223885f, -0.01325796f, 0.01865076f, -0.01504539f,
+        0.009393219f, -0.004967289f, 0.001934758f, -0.0005031487f, 2.163183e-05f, 7.128204e-05f, -3.604287e-05f, 1.899239e-06f },
+    { -0.9999819f, -0.9733983f, -0.5636718f, 0.1648176f, -0.03353497f, -0.0053723f, 0.01358667f, -0.0119876f,
+        0.007662651f, -0.004062646f, 0.001508426f, -0.0003229183f, -4.247608e-05f, 8.723223e-05f, -3.599878e-05f, 1.520769e-06f },
+    { -0.9999721f, -0.9698125f, -0.5393829f, 0.1741499f, -0.04411895f, 0.002344467f, 0.008547971f, -0.008918999f,
+        0.005922832f, -0.00315773f, 0.001087629f, -0.0001492475f, -0.0001018775f, 0.0001007679f, -3.519732e-05f, 1.197388e-06f },
+    { -0.9999584f, -0.9658537f, -0.5145521f, 0.1821111f, -0.05407759f, 0.009832839f, 0.00357881f, -0.005868737f,
+        0.004191204f, -0.002261901f, 0.0006767395f, 1.617806e-05f, -0.0001561078f, 0.0001118636f, -3.373183e-05f, 9.286208e-07f },
+    { -0.9999393f, -0.9614961f, -0.4892255f, 0.1886941f, -0.06335361f, 0.01703649f, -0.001278406f, -0.002864905f,
+        0.002484513f, -0.001384038f, 0.0002798125f, 0.0001718614f, -0.0002047959f, 0.0001205304f, -3.170338e-05f, 7.11356e-07f },
+    { -0.9999135f, -0.9567135f, -0.4634528f, 0.1938988f, -0.0718956f, 0.02390267f, -0.005983358f, 6.568433e-05f,
+        0.0008186649f, -0.0005324612f, -9.944753e-05f, 0.0003165021f, -0.0002476643f, 0.0001268138f, -2.921756e-05f, 5.405287e-07f },
+    { -0.9998792f, -0.9514795f, -0.4372876f, 0.1977315f, -0.07965839f, 0.03038259f, -0.01049813f, 0.002897728f,
+        -0.0007914084f, 0.0002851311f, -0.0004577123f, 0.0004490016f, -0.0002845267f, 0.0001307912f, -2.638144e-05f, 4.098048e-07f },
+    { -0.9998342f, -0.9457673f, -0.4107871f, 0.2002059f, -0.08660325f, 0.03643175f, -0.01478751f, 0.00560763f,
+        -0.002331867f, 0.001061723f, -0.0007920495f, 0.0005684661f, -0.0003152859f, 0.0001325682f, -2.330064e-05f, 3.122343e-07f },
+    { -0.999776f, -0.9395503f, -0.3840119f, 0.2013423f, -0.09269813f, 0.04201022f, -0.01881921f, 0.008173682f,
+        -0.003790068f, 0.001791027f, -0.001099938f, 0.0006742069f, -0.0003399294f, 0.0001322761f, -2.00767e-05f, 2.408349e-07f },
+    { -0.9997016f, -0.9328017f, -0.3570259f, 0.2011679f, -0.09791781f, 0.04708291f, -0.02256414f, 0.01057622f,
+        -0.00515465f, 0.002467523f, -0.001379277f, 0.0007657376f, -0.000358525f, 0.000130068f, -1.680469e-05f, 1.890796e-07f },
+    { -0.9996077f, -0.9254955f, -0.3298957f, 0.1997165f, -0.1022439f, 0.05161978f, -0.02599658f, 0.01279774f,
+        -0.006415605f, 0.003086484f, -0.00162839f, 0.0008427696f, -0.0003712152f, 0.000126115f, -1.357123e-05f, 1.512653e-07f },
+    { -0.9994902f, -0.9176057f, -0.3026909f, 0.1970286f, -0.1056652f, 0.05559596f, -0.02909431f, 0.01482304f,
+        -0.007564336f, 0.003643997f, -0.001846026f, 0.0009052052f, -0.000378211f, 0.0001206034f, -1.045286e-05f, 1.227514e-07f },
+    { -0.9993447f, -0.9091072f, -0.2754833f, 0.1931509f, -0.1081771f, 0.0589919f, -0.03183875f, 0.01663927f,
+        -0.008593694f, 0.004136972f, -0.002031351f, 0.0009531288f, -0.0003797853f, 0.0001137299f, -7.514851e-06f, 1.000656e-07f },
+    { -0.999166f, -0.8999757f, -0.2483467f, 0.1881362f, -0.1097823f, 0.06179341f, -0.03421506f, 0.01823599f,
+        -0.009497999f, 0.004563139f, -0.002183939f, 0.000986796f, -0.0003762658f, 0.0001056991f, -4.810398e-06f, 8.088333e-08f },
+    { -0.9989483f, -0.8901881f, -0.2213566f, 0.1820431f, -0.1104898f, 0.0639917f, -0.03621214f, 0.01960521f,
+        -0.01027305f, 0.004921041f, -0.002303758f, 0.001006622f, -0.0003680272f, 9.671913e-05f, -2.380285e-06f, 6.389906e-08f },
+    { -0.9986851f, -0.8797225f, -0.1945901f, 0.1749355f, -0.1103158f, 0.0655833f, -0.03782268f, 0.02074139f,
+        -0.01091611f, 0.005210014f, -0.00239115f, 0.001013166f, -0.0003554838f, 8.699879e-05f, -2.529064e-07f, 4.861343e-08f },
+    { -0.9983692f, -0.8685583f, -0.1681248f, 0.1668825f, -0.1092823f, 0.06657003f, -0.0390431f, 0.02164143f,
+        -0.01142588f, 0.005430163f, -0.002446813f, 0.00100712f, -0.0003390815f, 7.674407e-05f, 1.555324e-06f, 3.50699e-08f },
+    { -0.9979924f, -0.856677f, -0.1420391f, 0.1579575f, -0.1074179f, 0.06695886f, -0.03987354f, 0.02230461f,
+        -0.01180249f, 0.005582328f, -0.00247177f, 0.0009892909f, -0.0003192901f, 6.61553e-05f, 3.039227e-06f, 2.357699e-08f },
+    { -0.9975458f, -0.8440617f, -0.1164113f, 0.1482385f, -0.1047567f, 0.06676174f, -0.04031769f, 0.02273254f,
+        -0.01204739f, 0.005668041f, -0.002467347f, 0.0009605841f, -0.0002965959f, 5.542435e-05f, 4.203831e-06f, 1.44552e-08f },
+    { -0.9970195f, -0.830698f, -0.09131939f, 0.1378068f, -0.1013386f, 0.06599541f, -0.04038274f, 0.02292905f,
+        -0.01216334f, 0.005689486f, -0.002435139f, 0.0009219885f, -0.0002714937f, 4.473222e-05f, 5.063108e-06f, 7.843952e-09f },
+    { -0.9964028f, -0.8165734f, -0.06684057f, 0.1267469f, -0.09720827f, 0.06468111f, -0.04007916f, 0.02290011f,
+        -0.0121543f, 0.005649441f, -0.002376982f, 0.0008745587f, -0.00024448f, 3.424686e-05f, 5.638541e-06f, 3.597988e-09f },
+    { -0.9956839f, -0.8016785f, -0.0430507f, 0.1151461f, -0.09241519f, 0.06284438f, -0.03942058f, 0.02265369f,
+        -0.01202537f, 0.005551228f, -0.002294916f, 0.0008193987f, -0.0002160463f, 2.412136e-05f, 5.95757e-06f, 1.288255e-09f },
+    { -0.9948501f, -0.7860062f, -0.0200239f, 0.1030935f, -0.08701302f, 0.06051465f, -0.03842351f, 0.02219964f,
+        -0.01178268f, 0.005398648f, -0.002191156f, 0.0007576456f, -0.0001866725f, 1.44924e-05f, 6.051993e-06f, 3.047036e-10f },
+    { -0.9938875f, -0.7695528f, 0.00216792f, 0.0906798f, -0.08105912f, 0.05772498f, -0.03710717f, 0.0215495f,
+        -0.01143328f, 0.005195923f, -0.002068052f, 0.0006904533f, -0.0001568211f, 5.479148e-06f, 5.956372e-06f, 2.794101e-11f },
+    { -0.9927813f, -0.7523175f, 0.02345553f, 0.07799646f, -0.07461403f, 0.05451166f, -0.03549322f, 0.02071635f,
+        -0.01098506f, 0.004947626f, -0.00192806f, 0.0006189775f, -0.0001269321f, -2.817626e-06f, 5.706496e-06f, 0.f } };
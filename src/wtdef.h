@@ -14,6 +14,7 @@
 #define WT_UPPER 30
 #define WAVE_SYNC (NWAVES + 1)
 #define WAVE_STEP (NWAVES + 2)
+#define WT_MAX_WAVES 31 // maximum number of waves in a wavetable definition
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +51,15 @@ extern const float WSCALER[32];
  */
 extern const unsigned char WT28_SPAN[];
 
+/*
+ * For wavetable 29 (step): minBLEP residual, added to the samples after each step.
+ * Row: time from the step to the first sample, in 1/BLEP_PHASES of a sample.
+ * Column: sample after the step.
+ */
+#define BLEP_PHASES 32
+#define BLEP_LEN 16 // power of 2 (ring buffer in wtgen.h)
+extern const float MINBLEP[BLEP_PHASES + 1][BLEP_LEN];
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,11 +11,106 @@
 #include <stdint.h>
 #include "compat.h"
 #include "wtdef.h"
+#ifdef WTGEN_MIPMAP
+#include "wtmip.h"
+#endif
+
+/*
+    Wave storage
+    The waves are stored as the first half of the period (64 samples),
+    the second half is obtained by mirroring in time and amplitude.
+    If WTGEN_UNFOLD is defined, the waves used by the current wavetable are unfolded
+    into full periods (128 samples) when the wavetable is set, so that the readout
+    in mode 3 (WTMODE_NOINT) needs no mirroring. The interpolated modes read
+    the blended wave cache, which is built from the half period: no speed-up.
+    Cost: WTGEN_UNFOLD_BYTES of RAM per generator (3968 bytes, desktop builds: 7936 bytes),
+    up to 31 * 64 sample copies when the wavetable changes.
+    The desktop builds keep two sets of unfolded waves, for the two wavetable definitions (see below).
+*/
+#ifdef WTGEN_UNFOLD
+#define WAVE_LEN 128
+#ifdef USER_TARGET_PLATFORM
+#define WTGEN_UNFOLD_BUFS 1 // the waves are unfolded in apply_wavetable
+#else
+#define WTGEN_UNFOLD_BUFS 2 // the waves are unfolded in prepare_wavetable
+#endif
+#define WTGEN_UNFOLD_BYTES (WTGEN_UNFOLD_BUFS * WT_MAX_WAVES * WAVE_LEN)
+#else
+#define WAVE_LEN 64
+#define WTGEN_UNFOLD_BYTES 0
+#endif
+
+/*
+    Wavetable definitions
+    The wave indices of a memory wavetable (61 positions) and the wave pointers
+    are kept in two buffers: the active one, read by the generator,
+    and the prepared one, built by prepare_wavetable when the wavetable number changes.
+    apply_wavetable makes the prepared buffer active with a pointer swap,
+    so that a note start does not walk the wavetable definition.
+    Cost: 244 bytes + 31 pointers of RAM per generator.
+    With WTGEN_UNFOLD, the desktop builds unfold the waves into the prepared buffer as well.
+    The logue builds have a single set of unfolded waves (RAM), so they still unfold the waves
+    in apply_wavetable: up to 31 * 64 sample copies on Note On after a wavetable change.
+    prepare_wavetable is called by wvt_param, in the same thread as the generator
+    (logue: OSC_PARAM, JUCE plugin: the parameter queue of the audio thread), so no atomic swap is needed.
+*/
+
+/*
+    Fixed point generator
+    If WTGEN_Q15 is defined, the samples are generated in fixed point, with the Cortex-M4
+    dual multiply-accumulate instructions (SMLAD/SMUAD) instead of the FPU:
+    the blended wave is stored as packed Q8.7 pairs (sample, difference to the next sample),
+    so that the interpolation of a sample is a single SMUAD with the (1, alpha) pair.
+    Two waves are blended in the same way, with the (1 - alpha_w, alpha_w) pair.
+    The generated samples are int32 scaled by 2**20 (wtsample_t), decimated in fixed point.
+    Not available with WTGEN_MIPMAP (float waves) and in the voice banks.
+*/
+#ifdef WTGEN_Q15
+#ifdef WTGEN_MIPMAP
+#error "WTGEN_Q15 cannot be used with WTGEN_MIPMAP"
+#endif
+#define WTSAMPLE(y) ((int32_t)((y) * 1048576.f)) // float sample to wtsample_t, * 2**20
+#else
+#define WTSAMPLE(y) (y)
+#endif
+
+/*
+    Smooth wave number
+    If WTGEN_SMOOTH is defined, a change of the wave number may be spread over a block
+    (set_wave_ramp, memory waves in Mode 1): alpha_w changes linearly on every sample.
+    The blended wave is kept for the start of the ramp, the generator adds the change of alpha_w
+    multiplied by the difference of the two waves (at the nearest sample): one multiply-add per sample.
+    The waves are blended again at the end of each generated block and when the ramp crosses
+    to another pair of waves of the wavetable.
+    Cost: 512 bytes of RAM per generator (the wave difference).
+    Not available with WTGEN_Q15.
+*/
+#if defined(WTGEN_SMOOTH) && defined(WTGEN_Q15)
+#error "WTGEN_SMOOTH cannot be used with WTGEN_Q15"
+#endif
 
 #define MAX_PHASE 128.f
 #define Q25TOF 2.9802322387695312e-08f
 #define MASK_25 0x1ffffff
 
+/*
+    Frequency ramp (glide, pitch modulation): set_frequency_ramp changes the phase step linearly,
+    by step_inc per sample. This is a deliberate approximation: the step is not changed on every
+    sample, the block is generated in segments of up to FREQ_RAMP_SEG generator samples
+    (8 output samples at 2x), each with the step from the middle of the segment, so the phase
+    at the end of each segment is the same as with the step changed on every sample.
+    The generators are not changed (the skew and wavetable 29 segment the block assuming
+    a constant step), recip_step, the skew steps and the mipmap level are updated per segment.
+    Measured on x86-64 at 48 kHz, 2x, 7 Hz vibrato of +-2 semitones, against FREQ_RAMP_SEG 1
+    (the step changed on every sample): the difference is -102 dB (wavetable 0, note 48),
+    -84 dB (note 84), -74 dB at worst (wavetables 28 and 29, note 84); with one step per
+    output block (64) it is -78 .. -49 dB. The vibrato costs c.a. 2 ns/sample over a static
+    pitch, FREQ_RAMP_SEG 1 would cost 1.3 (wavetable 28) to 2.6 (wavetable 29) times more.
+*/
+#ifndef FREQ_RAMP_SEG
+#define FREQ_RAMP_SEG 16
+#endif
+
 // Wavetable modes
 typedef enum {
     WTMODE_INT2D = 0, // bilinear interpolation: wave and sample
@@ -23,35 +118,86 @@ typedef enum {
     WTMODE_NOINT = 2 // no interpolation
 } WtMode;
 
+// Pending minBLEP residual of the transitions, for wavetable 29
+typedef struct {
+    float res[BLEP_LEN]; // residual (ring buffer)
+    uint8_t pos; // next sample of res
+    uint8_t left; // number of res samples to be used, 0: none
+} BlepState;
+
 typedef struct WtGenState {
-    float (*generate)(struct WtGenState*); // pointer to function generating samples
-    uint8_t wavetable[61][4]; // wavetable definition
+    void (*generate)(struct WtGenState*, wtsample_t*, uint32_t); // pointer to function generating a block of samples
+    uint8_t (*wavetable)[4]; // active wavetable definition (wtbuf)
+    const uint8_t** pwaves; // pointers to samples of the waves in the active wavetable (pwbuf)
+    uint8_t wtbuf[2][61][4]; // wavetable definitions: active and prepared
+    const uint8_t* pwbuf[2][WT_MAX_WAVES]; // pointers to the waves for wtbuf
+    uint8_t wtsel; // index of the active buffer
+    uint8_t wtnext; // prepared wavetable number, 0xFF: none
     uint8_t wtnum; // wavetable number
     uint8_t wtmode; // wavetable mode
-    uint8_t wave[2]; // numbers of the stored waves (indices into WAVES)
-    uint8_t* pwave[2]; // pointer to samples of the waves
+    uint8_t wave[2]; // numbers of the current waves (indices into pwaves)
+    const uint8_t* pwave[2]; // pointer to samples of the current waves
     float alpha_w; // linear interpolation coefficient
+#ifdef WTGEN_Q15
+    uint32_t wpair[128]; // waves blended with alpha_w, full period, Q8.7 pairs: sample (low), difference (high)
+#else
+    float wcache[129]; // waves blended with alpha_w, full period + guard sample, offset removed
+#endif
+#ifdef WTGEN_SMOOTH
+    float wdiff[128]; // difference of the current waves (wave 1 - wave 0), full period
+    float nwave; // current wavetable position, 0..61
+    float nwave_end; // wavetable position at the end of the ramp
+    float nwave_step; // change of the wavetable position per sample
+    float alpha_off; // change of alpha_w since the waves were blended
+    float alpha_step; // change of alpha_w per sample
+    uint32_t ramp_left; // number of samples left in the ramp, 0: no ramp
+#endif
+#ifdef WTGEN_UNFOLD
+    uint8_t wunfold[WTGEN_UNFOLD_BUFS][WT_MAX_WAVES][WAVE_LEN]; // unfolded waves (for wtbuf, desktop builds)
+#endif
     uq7_25_t phase; // signal phase, UQ7.25
     uq7_25_t step; // step to increase the phase, UQ7.25
     float recip_step; // 1/step as float
+    int32_t step_inc; // change of the phase step per sample, during the frequency ramp
+    uint32_t step_left; // number of samples left in the frequency ramp, 0: no ramp
+    float ramp_freq; // frequency at the end of the ramp
     float phase_scaler; // 1/(ovs*srate)
-    float sync_step; // sync step for wavetable 28
-    float sync_period; // sync period for wavetable 28
+    float sync_step; // sync step for wavetable 28 (number of sync periods in the wave period)
+    float sync_end; // half of the amplitude jump at the period end, for wavetable 28
+    uint8_t sync_count; // number of sync resets inside the wave period, for wavetable 28
+    BlepState blep; // pending minBLEP residual, for wavetable 29
     uq7_25_t skew_bp; // phase skew breakpoint, UQ7.25
     float skew_r1; // phase skew rate below the breakpoint
     float skew_r2; // phase skew rate above the breakpoint
+    uq7_25_t skew_step1; // read phase step below the breakpoint (step * skew_r1)
+    uq7_25_t skew_step2; // read phase step above the breakpoint (step * skew_r2)
+#ifdef WTGEN_MIPMAP
+    uint8_t bandlimit; // 1: use band-limited waves (WAVES_MIP)
+    uint8_t mip_level; // level of the band-limited waves for the current frequency
+#endif
     q7_24_t last_wavenum; // last wave number that was set
     uint8_t last_wtnum; // last wavetable number that was set
 } WtGenState;
 
+_INLINE void wtgen_reset(WtGenState* state);
+_INLINE void update_skew_steps(WtGenState* state);
+_INLINE void prepare_wavetable(WtGenState* state, uint8_t ntable);
+_INLINE void apply_wavetable(WtGenState* state);
 _INLINE void set_wavetable(WtGenState* state, uint8_t ntable);
 _INLINE void set_wave_number(WtGenState* state, q7_24_t wavenum);
-_INLINE float generate_wavecycles(WtGenState* state);
-_INLINE float generate_wavecycles_noint(WtGenState* state);
-_INLINE float generate_wt28(WtGenState* state);
-_INLINE float generate_wt28_noint(WtGenState* state);
-_INLINE float generate_wt29(WtGenState* state);
-_INLINE float generate_wt29_noint(WtGenState* state);
+_INLINE void select_waves(WtGenState* state, float nwave);
+_INLINE void blend_waves(WtGenState* state);
+#ifdef WTGEN_MIPMAP
+_INLINE void update_mip_level(WtGenState* state);
+_INLINE void refresh_wave_cache(WtGenState* state);
+#endif
+_INLINE void generate_wavecycles(WtGenState* state, wtsample_t* __restrict out, uint32_t n);
+_INLINE void generate_wavecycles_noint(WtGenState* state, wtsample_t* __restrict out, uint32_t n);
+_INLINE void generate_wt28(WtGenState* state, wtsample_t* __restrict out, uint32_t n);
+_INLINE void generate_wt28_noint(WtGenState* state, wtsample_t* __restrict out, uint32_t n);
+_INLINE void generate_wt29(WtGenState* state, wtsample_t* __restrict out, uint32_t n);
+_INLINE void generate_wt29_polyblep(WtGenState* state, wtsample_t* __restrict out, uint32_t n);
+_INLINE void generate_wt29_noint(WtGenState* state, wtsample_t* __restrict out, uint32_t n);
 
 /*  wtgen_init
     Initialize the generator
@@ -59,21 +205,39 @@ _INLINE float generate_wt29_noint(WtGenState* state);
 */
 _INLINE void wtgen_init(WtGenState* state, float srate)
 {
-    state->wave[0] = WAVETABLES[0][0];
-    state->wave[1] = WAVETABLES[0][1];
-    state->pwave[0] = (uint8_t*)&WAVES[state->wave[0]][0];
-    state->pwave[1] = (uint8_t*)&WAVES[state->wave[1]][0];
+    state->wave[0] = 0;
+    state->wave[1] = 0;
+    state->pwave[0] = &WAVES[WAVETABLES[0][1]][0];
+    state->pwave[1] = &WAVES[WAVETABLES[0][1]][0];
     state->alpha_w = 0;
-    state->phase = 0;
+#ifdef WTGEN_SMOOTH
+    state->nwave = state->nwave_end = state->nwave_step = 0;
+    state->alpha_off = state->alpha_step = 0;
+    state->ramp_left = 0;
+#endif
     state->step = 0x2000000;
+    state->step_inc = 0;
+    state->step_left = 0;
+    state->ramp_freq = 0;
     state->phase_scaler = 1.f / srate;
     state->sync_step = 1.f;
-    state->sync_period = 128.f;
+    state->sync_end = -64.f;
+    state->sync_count = 0;
     state->skew_bp = 0;
     state->skew_r1 = state->skew_r2 = 1.f;
+    state->skew_step1 = state->skew_step2 = state->step;
+#ifdef WTGEN_MIPMAP
+    state->bandlimit = 0;
+    state->mip_level = 0;
+#endif
     state->last_wavenum = 0;
     state->last_wtnum = 255;
+    state->wtsel = 0;
+    state->wtnext = 0xFF;
+    state->wavetable = state->wtbuf[0];
+    state->pwaves = state->pwbuf[0];
     set_wavetable(state, 0);
+    wtgen_reset(state);
 }
 
 /*  wtgen_reset
@@ -81,11 +245,27 @@ _INLINE void wtgen_init(WtGenState* state, float srate)
 */
 _INLINE void wtgen_reset(WtGenState* state)
 {
+    uint32_t i;
     state->phase = 0;
+    // no pending transitions
+    state->blep.pos = 0;
+    state->blep.left = 0;
+    for (i = 0; i < BLEP_LEN; i++)
+        state->blep.res[i] = 0.f;
+}
+
+/*  wtgen_set_srate
+    Change the sampling rate of the generator.
+    set_frequency must be called afterwards to update the phase step.
+    srate: sampling rate in Hz
+*/
+_INLINE void wtgen_set_srate(WtGenState* state, float srate)
+{
+    state->phase_scaler = 1.f / srate;
 }
 
 /*  set_frequency
-    Set frequency of the oscscillator
+    Set frequency of the oscscillator, stop the frequency ramp.
     freq: frequency in Hz
 */
 _INLINE void set_frequency(WtGenState* state, float freq)
@@ -93,6 +273,167 @@ _INLINE void set_frequency(WtGenState* state, float freq)
     const float step_f = freq * state->phase_scaler;
     state->step = (uq7_25_t)(step_f * 4294967296.f); // step * 2**32
     state->recip_step = 0.0078125f / step_f; // (1/128)/step_f
+    state->step_left = 0;
+    if (state->skew_bp)
+        update_skew_steps(state);
+#ifdef WTGEN_MIPMAP
+    if (state->bandlimit)
+        update_mip_level(state);
+#endif
+}
+
+/*  set_frequency_ramp
+    Change the frequency linearly (in the phase step) over the next n samples.
+    If the change is below one step unit per sample (or n < 2), the frequency is set immediately.
+    freq: frequency in Hz at the end of the ramp
+    n: number of samples
+*/
+_INLINE void set_frequency_ramp(WtGenState* state, float freq, uint32_t n)
+{
+    const uq7_25_t step_end = (uq7_25_t)(freq * state->phase_scaler * 4294967296.f);
+    const int64_t d = (int64_t)step_end - (int64_t)state->step;
+    if ((n < 2) || ((d < (int64_t)n) && (d > -(int64_t)n))) {
+        set_frequency(state, freq);
+        return;
+    }
+    state->step_inc = (int32_t)(d / (int64_t)n);
+    state->step_left = n;
+    state->ramp_freq = freq;
+}
+
+/*  update_ramp_step
+    Update the values derived from the phase step, during the frequency ramp.
+    recip_step is needed only by the band-limited wavetables 28 and 29.
+*/
+_INLINE void update_ramp_step(WtGenState* state)
+{
+    if ((state->wtnum == WT_SYNC) || (state->wtnum == WT_STEP))
+        state->recip_step = 33554432.f / (float)state->step; // 2**25/step
+    if (state->skew_bp)
+        update_skew_steps(state);
+#ifdef WTGEN_MIPMAP
+    if (state->bandlimit)
+        update_mip_level(state);
+#endif
+}
+
+/*  wtgen_uses_cache
+    Returns 1 if the samples are read from the blended wave cache
+    (generate_wavecycles: memory waves, modes 1 and 2).
+*/
+_INLINE int wtgen_uses_cache(const WtGenState* state)
+{
+    return (state->wtnum != WT_SYNC) && (state->wtnum != WT_STEP) && (state->wtmode != WTMODE_NOINT);
+}
+
+/*  wtgen_ramping
+    Returns 1 if the wave number is ramped in the current block (WTGEN_SMOOTH).
+*/
+_INLINE int wtgen_ramping(const WtGenState* state)
+{
+#ifdef WTGEN_SMOOTH
+    return state->ramp_left != 0;
+#else
+    (void)state;
+    return 0;
+#endif
+}
+
+#ifdef WTGEN_MIPMAP
+/*  wtgen_set_bandlimit
+    Enable or disable the band-limited waves.
+    The band-limited waves are used in modes 1 and 2 (interpolated samples);
+    mode 3 is always generated from the original waves.
+    on: 1 - band-limited waves, selected according to the frequency,
+        0 - original waves (PPG style, aliasing depends on oversampling)
+*/
+_INLINE void wtgen_set_bandlimit(WtGenState* state, uint8_t on)
+{
+    wtmip_init();
+    state->bandlimit = on;
+    if (on) {
+        update_mip_level(state);
+    } else if (state->mip_level) {
+        state->mip_level = 0;
+        refresh_wave_cache(state);
+    }
+}
+
+/*  update_mip_level
+    Select the band-limited waves for the current frequency.
+    Level L has (64 >> L) harmonics, which are below the Nyquist frequency
+    if step <= 2**(25+L). Rebuilds the blended wave cache if the level changes.
+*/
+_INLINE void update_mip_level(WtGenState* state)
+{
+    uint8_t level = 0;
+    uint32_t s = (state->step - 1) >> 25;
+    while (s && (level < MIP_LEVELS - 1)) {
+        level++;
+        s >>= 1;
+    }
+    if (level == state->mip_level)
+        return;
+    state->mip_level = level;
+    refresh_wave_cache(state);
+}
+
+/*  refresh_wave_cache
+    Rebuild the blended wave cache, if it is used and valid.
+*/
+_INLINE void refresh_wave_cache(WtGenState* state)
+{
+    if (wtgen_uses_cache(state) && (state->wave[0] != 0xFF))
+        blend_waves(state);
+}
+#endif
+
+/*  update_skew_steps
+    Calculate the read phase steps of the skew, after a change of the phase step or the skew.
+    A step longer than the period is limited (it is never used for more than one sample,
+    the read phase is resynchronized in skew_segment).
+*/
+_INLINE void update_skew_steps(WtGenState* state)
+{
+    const float step = (float)state->step;
+    const float s1 = step * state->skew_r1;
+    const float s2 = step * state->skew_r2;
+    state->skew_step1 = (s1 < 4294967040.f) ? (uq7_25_t)s1 : 0xFFFFFF00;
+    state->skew_step2 = (s2 < 4294967040.f) ? (uq7_25_t)s2 : 0xFFFFFF00;
+}
+
+/*  skew_read_phase
+    Map the phase to the read phase of the skewed wave: 0..bp to 0..64, bp..128 to 64..128.
+    Returns: read phase, UQ7.25
+*/
+_INLINE uq7_25_t skew_read_phase(const WtGenState* state, uq7_25_t phase)
+{
+    if (phase <= state->skew_bp)
+        return (uq7_25_t)(state->skew_r1 * (float)phase);
+    return 0x80000000 + (uq7_25_t)(state->skew_r2 * (float)(phase - state->skew_bp));
+}
+
+/*  skew_segment
+    Number of samples from the phase to the next switch of the skew rate
+    (the breakpoint or the period end), at most n.
+    rphase, rstep: read phase and its step for these samples
+*/
+_INLINE uint32_t skew_segment(const WtGenState* state, uq7_25_t phase, uint32_t n, uq7_25_t* rphase, uq7_25_t* rstep)
+{
+    const uq7_25_t step = state->step;
+    uq7_25_t d; // distance to the last phase before the switch
+    if (phase <= state->skew_bp) {
+        d = state->skew_bp - phase;
+        *rstep = state->skew_step1;
+    } else {
+        d = 0xFFFFFFFF - phase;
+        *rstep = state->skew_step2;
+    }
+    *rphase = skew_read_phase(state, phase);
+    if (!step)
+        return n;
+    const uint32_t k = d / step + 1;
+    return (k < n) ? k : n;
 }
 
 /*  set_skew
@@ -106,6 +447,7 @@ _INLINE void set_skew(WtGenState* state, uq7_25_t bp)
         const float fbp = (float)bp * Q25TOF;
         state->skew_r1 = 64.f / fbp;
         state->skew_r2 = 64.f / (128.f - fbp);
+        update_skew_steps(state);
     } else {
         state->skew_bp = 0;
         // state->skew_bp = 64.f;
@@ -113,14 +455,98 @@ _INLINE void set_skew(WtGenState* state, uq7_25_t bp)
     }
 }
 
-/*  set_wavetable
-    Set the wavetable number.
+#ifdef WTGEN_UNFOLD
+/*  unfold_wave
+    Unfold a wave to the full period.
+    pu: output, WAVE_LEN samples
+    pw: half period of the wave, 64 samples
+*/
+_INLINE void unfold_wave(uint8_t* __restrict pu, const uint8_t* __restrict pw)
+{
+    uint8_t i;
+    for (i = 0; i < 64; i++) {
+        pu[i] = pw[i];
+        pu[127 - i] = ~pw[i];
+    }
+}
+#endif
+
+/*  prepare_wavetable
+    Prepare a wavetable to be set with apply_wavetable:
+    build the wave indices of a memory wavetable in the inactive buffer
+    (and unfold its waves, WTGEN_UNFOLD desktop builds).
+    The generator is not changed.
     ntable: wavetable number, 0..95
 */
-_INLINE void set_wavetable(WtGenState* state, uint8_t ntable)
+_INLINE void prepare_wavetable(WtGenState* state, uint8_t ntable)
 {
-    if (ntable == state->last_wtnum)
-        return; // already set
+    if (ntable == state->last_wtnum) {
+        state->wtnext = 0xFF; // already set, drop any prepared wavetable
+        return;
+    }
+    if (ntable == state->wtnext)
+        return; // already prepared
+    state->wtnext = ntable;
+
+    const uint8_t wtnum = ntable & 0x1F;
+    if ((wtnum == WT_SYNC) || (wtnum == WT_STEP))
+        return; // no memory waves
+
+    // Build wavetable indices for wave interpolation
+    // entry 1: lower wave number (index into pwaves)
+    // entry 2: upper wave number (index into pwaves)
+    // entry 3: distance from the lower wave position
+    // entry 4: span between the lower and the upper wave
+
+    const uint8_t sel = state->wtsel ^ 1;
+    uint8_t(*const wt)[4] = state->wtbuf[sel];
+    const uint8_t** const pw = state->pwbuf[sel];
+    const uint8_t* pwtdef = &WAVETABLES[wtnum][0];
+    uint8_t n, k, p1, p2;
+
+    // store pointers to the waves used in the wavetable
+    k = 0;
+    do {
+#if defined(WTGEN_UNFOLD) && (WTGEN_UNFOLD_BUFS == 2)
+        // unfold to the full period, into the inactive set
+        uint8_t* const pu = &state->wunfold[sel][k][0];
+        unfold_wave(pu, &WAVES[pwtdef[2 * k + 1]][0]);
+        pw[k] = pu;
+#else
+        pw[k] = &WAVES[pwtdef[2 * k + 1]][0];
+#endif
+    } while (pwtdef[2 * k++] < 60);
+
+    k = 0;
+    p1 = pwtdef[0];
+    p2 = pwtdef[2];
+    for (n = 0; n < 60; n++) {
+        if (n == p2) {
+            k++;
+            p1 = p2;
+            p2 = pwtdef[2 * k + 2];
+        }
+        wt[n][0] = k;
+        wt[n][1] = k + 1;
+        wt[n][2] = p1;
+        wt[n][3] = p2 - p1;
+    }
+    wt[60][0] = k;
+    wt[60][1] = k + 1;
+    wt[60][2] = p1;
+    wt[60][3] = p2 - p1;
+}
+
+/*  apply_wavetable
+    Set the wavetable prepared with prepare_wavetable, if there is one.
+    The wave indices are switched with a pointer swap.
+*/
+_INLINE void apply_wavetable(WtGenState* state)
+{
+    const uint8_t ntable = state->wtnext;
+    if (ntable == 0xFF)
+        return; // nothing prepared
+    state->wtnext = 0xFF;
     state->last_wtnum = ntable;
 
     // normalize wavetable number
@@ -150,35 +576,21 @@ _INLINE void set_wavetable(WtGenState* state, uint8_t ntable)
         break;
 
     default: {
-        // Build wavetable indices for wave interpolation
-        // entry 1: lower wave number
-        // entry 2: upper wave number
-        // entry 3: distance from the lower wave position
-        // entry 4: span between the lower and the upper wave
-
-        const uint8_t* pwtdef = &WAVETABLES[state->wtnum][0];
-        uint8_t n, p1, w1, p2, w2;
-
-        p1 = *pwtdef++;
-        w1 = *pwtdef++;
-        p2 = *pwtdef++;
-        w2 = *pwtdef++;
-        for (n = 0; n < 60; n++) {
-            if (n == p2) {
-                p1 = p2;
-                w1 = w2;
-                p2 = *pwtdef++;
-                w2 = *pwtdef++;
-            }
-            state->wavetable[n][0] = w1;
-            state->wavetable[n][1] = w2;
-            state->wavetable[n][2] = p1;
-            state->wavetable[n][3] = p2 - p1;
-        }
-        state->wavetable[60][0] = w1;
-        state->wavetable[60][1] = w2;
-        state->wavetable[60][2] = p1;
-        state->wavetable[60][3] = p2 - p1;
+        // swap the buffers
+        const uint8_t sel = state->wtsel ^ 1;
+        state->wtsel = sel;
+        state->wavetable = state->wtbuf[sel];
+        state->pwaves = state->pwbuf[sel];
+#if defined(WTGEN_UNFOLD) && (WTGEN_UNFOLD_BUFS == 1)
+        // unfold the waves to the full period (a single set, logue)
+        const uint8_t* const pwtdef = &WAVETABLES[state->wtnum][0];
+        uint8_t k = 0;
+        do {
+            uint8_t* const pu = &state->wunfold[0][k][0];
+            unfold_wave(pu, state->pwaves[k]);
+            state->pwaves[k] = pu;
+        } while (pwtdef[2 * k++] < 60);
+#endif
 
         switch (state->wtmode) {
         case WTMODE_NOINT:
@@ -192,19 +604,27 @@ _INLINE void set_wavetable(WtGenState* state, uint8_t ntable)
 
     const q7_24_t last_wn = state->last_wavenum;
     state->last_wavenum = (q7_24_t)0xFFFFFFFF;
+    state->wave[0] = 0xFF; // invalidate the blended wave cache
     set_wave_number(state, last_wn); // recalculate wave number
 }
 
-/*  set_wave_number
-    Set the wave number - position within the wavetable.
-    wavenum: requested wave number, Q7.24 (signed)
+/*  set_wavetable
+    Set the wavetable number immediately.
+    ntable: wavetable number, 0..95
 */
-_INLINE void set_wave_number(WtGenState* state, q7_24_t wavenum)
+_INLINE void set_wavetable(WtGenState* state, uint8_t ntable)
 {
-    if (wavenum == state->last_wavenum)
-        return; // already set
-    state->last_wavenum = wavenum;
+    prepare_wavetable(state, ntable);
+    apply_wavetable(state);
+}
 
+/*  wave_position
+    Convert the wave number to the wavetable position.
+    wavenum: wave number, Q7.24 (signed), mirrored to 0..64
+    Returns: floating point wavetable position, 0..61
+*/
+_INLINE float wave_position(q7_24_t wavenum)
+{
     // Normalize wave number
     // wavenum is signed Q7.24 (-128..127)
     // convert to unsigned Q6.24 (0..64) with mirroring
@@ -213,9 +633,28 @@ _INLINE void set_wave_number(WtGenState* state, q7_24_t wavenum)
     const int32_t norm_wavenum = (tmp ^ sign) + sign; // normalized to (0..64)
 
     // Convert to floating point wavetable position, 0..61
-    const float nwave = (float)norm_wavenum * 5.681067705154419e-08f; // * (2**-24 * 61 / 64)
+    return (float)norm_wavenum * 5.681067705154419e-08f; // * (2**-24 * 61 / 64)
+}
+
+/*  set_wave_number
+    Set the wave number - position within the wavetable.
+    wavenum: requested wave number, Q7.24 (signed)
+*/
+_INLINE void set_wave_number(WtGenState* state, q7_24_t wavenum)
+{
+    if (wavenum == state->last_wavenum)
+        return; // already set
+    state->last_wavenum = wavenum;
+
+    const float nwave = wave_position(wavenum);
     const uint8_t nwave_i = (uint8_t)nwave; // integer part of the wave number, 0..60
     // const float nwave_f = (float)nwave - nwave_i; // fractional part of the wave number
+#ifdef WTGEN_SMOOTH
+    // stop the ramp
+    state->nwave = state->nwave_end = nwave;
+    state->ramp_left = 0;
+    state->alpha_step = 0;
+#endif
 
     switch (state->wtnum) {
     case WT_SYNC:
@@ -224,8 +663,13 @@ _INLINE void set_wave_number(WtGenState* state, q7_24_t wavenum)
         state->alpha_w = (state->wtmode == WTMODE_INT2D) ? nwave : (float)nwave_i;
         // amplitude step for one sample (scaler value found experimentally)
         state->sync_step = state->alpha_w * 0.0859375f + 1.f;
-        // sync period - amplitude resets after this number of samples
-        state->sync_period = MAX_PHASE / state->sync_step; // ceil
+        // sync period (MAX_PHASE / sync_step samples) - the amplitude resets after each period,
+        // the resets inside the wave period are at 1..sync_count sync periods
+        state->sync_count = (uint8_t)state->sync_step;
+        if ((float)state->sync_count == state->sync_step)
+            state->sync_count--; // the last reset is at the period end
+        // jump at the period end, from the last ramp value to -64
+        state->sync_end = 64.f * ((float)state->sync_count - state->sync_step);
         break;
 
     case WT_STEP:
@@ -236,208 +680,600 @@ _INLINE void set_wave_number(WtGenState* state, q7_24_t wavenum)
 
     default:
         // Memory waves
-        // find two waves used for interpolation
-        state->wave[0] = state->wavetable[nwave_i][0];
-        state->wave[1] = state->wavetable[nwave_i][1];
-        state->pwave[0] = (uint8_t*)&WAVES[state->wave[0]][0];
-        state->pwave[1] = (uint8_t*)&WAVES[state->wave[1]][0];
-        if (state->wtmode == WTMODE_INT2D) {
-            state->alpha_w = (nwave - state->wavetable[nwave_i][2]) * WSCALER[state->wavetable[nwave_i][3] - 1];
-        } else {
-            // only integer wave positions
-            state->alpha_w = ((uint8_t)(nwave + 0.5f) - state->wavetable[nwave_i][2]) * WSCALER[state->wavetable[nwave_i][3] - 1];;
+        select_waves(state, nwave);
+    }
+}
+
+/*  select_waves
+    Find the two memory waves used for interpolation at a wavetable position
+    and blend them, if they or alpha_w changed.
+    nwave: wavetable position, 0..61
+*/
+_INLINE void select_waves(WtGenState* state, float nwave)
+{
+    const uint8_t nwave_i = (uint8_t)nwave; // integer part of the wave number, 0..60
+    const uint8_t w0 = state->wavetable[nwave_i][0];
+    const uint8_t w1 = state->wavetable[nwave_i][1];
+    float alpha_w;
+    if (state->wtmode == WTMODE_INT2D) {
+        alpha_w = (nwave - state->wavetable[nwave_i][2]) * WSCALER[state->wavetable[nwave_i][3] - 1];
+    } else {
+        // only integer wave positions
+        alpha_w = ((uint8_t)(nwave + 0.5f) - state->wavetable[nwave_i][2]) * WSCALER[state->wavetable[nwave_i][3] - 1];
+    }
+    if ((w0 == state->wave[0]) && (w1 == state->wave[1]) && (alpha_w == state->alpha_w))
+        return; // the same waves, the cache is valid
+    state->wave[0] = w0;
+    state->wave[1] = w1;
+    state->pwave[0] = state->pwaves[w0];
+    state->pwave[1] = state->pwaves[w1];
+    state->alpha_w = alpha_w;
+    if (state->wtmode != WTMODE_NOINT)
+        blend_waves(state);
+}
+
+#ifdef WTGEN_SMOOTH
+/*  set_wave_ramp
+    Change the wave number linearly over the next n samples.
+    Only for memory waves in Mode 1, otherwise the wave number is set immediately.
+    wavenum: wave number at the end of the ramp, Q7.24 (signed)
+    n: number of samples
+*/
+_INLINE void set_wave_ramp(WtGenState* state, q7_24_t wavenum, uint32_t n)
+{
+    if ((state->wtnum == WT_SYNC) || (state->wtnum == WT_STEP) || (state->wtmode != WTMODE_INT2D) || !n) {
+        set_wave_number(state, wavenum);
+        return;
+    }
+    if (wavenum == state->last_wavenum)
+        return; // already set
+    if (state->ramp_left) {
+        // the previous ramp was not finished
+        state->nwave = state->nwave_end;
+        select_waves(state, state->nwave);
+    }
+    const float nwave_end = wave_position(wavenum);
+    const float nwave_step = (nwave_end - state->nwave) / (float)n;
+    if (nwave_step == 0.f) {
+        set_wave_number(state, wavenum);
+        return;
+    }
+    state->last_wavenum = wavenum;
+    state->nwave_end = nwave_end;
+    state->nwave_step = nwave_step;
+    state->alpha_step = nwave_step * WSCALER[state->wavetable[(uint8_t)state->nwave][3] - 1];
+    state->ramp_left = n;
+}
+
+/*  ramp_segment
+    Number of samples of the ramp to generate with the current pair of waves, at most n.
+*/
+_INLINE uint32_t ramp_segment(const WtGenState* state, uint32_t n)
+{
+    const uint8_t* const wt = state->wavetable[(uint8_t)state->nwave];
+    const float step = state->nwave_step;
+    // samples to the end of the pair: wavetable positions wt[2]..wt[2] + wt[3]
+    // (the last pair is also used above its end, up to position 61)
+    const float k = (step > 0.f) ? ((float)(wt[2] + wt[3]) - state->nwave) / step
+                                 : ((float)wt[2] - state->nwave) / step;
+    uint32_t ks = (k < (float)n) ? ((k > 0.f) ? (uint32_t)k + 1 : 1) : n;
+    if (ks > state->ramp_left)
+        ks = state->ramp_left;
+    return (ks < n) ? ks : n;
+}
+
+/*  advance_ramp
+    Move the wavetable position after k samples of the ramp and blend the waves for it.
+*/
+_INLINE void advance_ramp(WtGenState* state, uint32_t k)
+{
+    state->ramp_left -= k;
+    state->nwave = state->ramp_left ? state->nwave + (float)k * state->nwave_step : state->nwave_end;
+    select_waves(state, state->nwave);
+    state->alpha_off = 0;
+    state->alpha_step = state->ramp_left ? state->nwave_step * WSCALER[state->wavetable[(uint8_t)state->nwave][3] - 1] : 0.f;
+}
+#endif
+
+/*  blend_waves
+    Interpolate the two current waves with alpha_w and store the result
+    as a full period (with the mirrored second half) in the wave cache.
+    Called only when the waves or alpha_w change, normally once per block at most,
+    so that the sample generator only needs a linear interpolation of one wave.
+*/
+_INLINE void blend_waves(WtGenState* state)
+{
+#ifdef WTGEN_MIPMAP
+    if (state->mip_level) {
+        // band-limited waves, centered around zero
+        const uint8_t* const pwtdef = WAVETABLES[state->wtnum];
+        const float* const pm0 = WAVES_MIP[pwtdef[2 * state->wave[0] + 1]][state->mip_level - 1];
+        const float* const pm1 = WAVES_MIP[pwtdef[2 * state->wave[1] + 1]][state->mip_level - 1];
+        const float alpha_w = state->alpha_w;
+        float* const wc = state->wcache;
+        int i;
+        for (i = 0; i < 64; i++) {
+            const float y = (1.f - alpha_w) * pm0[i] + alpha_w * pm1[i];
+            wc[i] = y;
+            wc[127 - i] = -y;
         }
+        wc[128] = wc[0];
+#ifdef WTGEN_SMOOTH
+        for (i = 0; i < 64; i++) {
+            state->wdiff[i] = pm1[i] - pm0[i];
+            state->wdiff[127 - i] = pm0[i] - pm1[i];
+        }
+#endif
+        return;
+    }
+#endif
+    const uint8_t* const pw0 = state->pwave[0];
+    const uint8_t* const pw1 = state->pwave[1];
+#ifdef WTGEN_Q15
+    const int32_t a = (int32_t)(state->alpha_w * 16384.f + 0.5f); // Q14
+    const uint32_t wgt = pkhbt(16384 - a, a, 16); // (1 - alpha_w, alpha_w)
+    int16_t y[129];
+    int i;
+    for (i = 0; i < 64; i++) {
+        // blended sample, Q8.14 rounded to Q8.7
+        const int32_t v = (int32_t)smlad(pkhbt(pw0[i], pw1[i], 16), wgt, 64) >> 7;
+        y[i] = (int16_t)(v - 127 * 128);
+        y[127 - i] = (int16_t)(128 * 128 - v); // mirrored second half
+    }
+    y[128] = y[0];
+    for (i = 0; i < 128; i++)
+        state->wpair[i] = pkhbt(y[i], y[i + 1] - y[i], 16);
+#else
+    const float alpha_w = state->alpha_w;
+    float* const wc = state->wcache;
+    // (the first half is read also if the waves are unfolded: half the work)
+    int i;
+    for (i = 0; i < 64; i++) {
+        const float y = (1.f - alpha_w) * pw0[i] + alpha_w * pw1[i];
+        wc[i] = y - 127.f;
+        // the second half is mirrored in time and amplitude: (255 - y) - 127
+        wc[127 - i] = 128.f - y;
+    }
+    wc[128] = wc[0]; // guard sample for interpolation at the period end
+#ifdef WTGEN_SMOOTH
+    for (i = 0; i < 64; i++) {
+        const float d = (float)pw1[i] - (float)pw0[i];
+        state->wdiff[i] = d;
+        state->wdiff[127 - i] = -d;
     }
+#endif
+#endif
 }
 
-/*  generate
-    Calculate and return one sample value.
-    Proxy function that calls the actual function.
-    Returns: sample value, floating point, -127.5 to 127.5
+/*  generate_block
+    Calculate a block of samples.
+    Proxy function that calls the actual block generator for the current mode.
+    The generator is selected once per block, in set_wavetable.
+    out: output buffer, sample values, -127.5 to 127.5 (WTSAMPLE)
+    n: number of samples to generate
 */
-_INLINE float generate(WtGenState* state)
+_INLINE void generate_block(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
 {
-    return state->generate(state);
+    // frequency ramp, in segments with the step from the middle of the segment
+    while (state->step_left && n) {
+        const uint32_t k = (n < FREQ_RAMP_SEG) ? ((n < state->step_left) ? n : state->step_left)
+                                               : ((FREQ_RAMP_SEG < state->step_left) ? FREQ_RAMP_SEG : state->step_left);
+        const uq7_25_t step0 = state->step;
+        state->step = step0 + (uq7_25_t)(((int64_t)state->step_inc * (k - 1)) / 2);
+        update_ramp_step(state);
+        state->generate(state, out, k);
+        state->step_left -= k;
+        if (state->step_left)
+            state->step = step0 + (uq7_25_t)((int64_t)state->step_inc * k);
+        else
+            set_frequency(state, state->ramp_freq); // the exact final values
+        out += k;
+        n -= k;
+    }
+    if (n)
+        state->generate(state, out, n);
 }
 
-/*  generate_wavecycles
-    Calculate and return one sample value.
-    Uses wavetables with memory waves.
-    Interpolate sample values.
+/*  read_wavecycles_noint
+    Read one sample from two memory waves, without sample interpolation.
+    pw0, pw1: samples of the waves (the first half of the period, or the full period)
+    pos: integer sample position, 0..127
+    alpha_w: wave interpolation coefficient
     Returns: sample value, floating point, -127.5 to 127.5
 */
-_INLINE float generate_wavecycles(WtGenState* state)
+_INLINE float read_wavecycles_noint(const uint8_t* pw0, const uint8_t* pw1, uint8_t pos, float alpha_w)
 {
-    float out1, out2, y;
-    uint8_t w11, w12, w21, w22;
-    uint8_t pos, pos2; // integer sample position, 0..128
-    float alpha; // fractional part of the sample position
+    uint8_t w11, w21;
 
-    if (!state->skew_bp) {
-        pos = (uint8_t)(state->phase >> 25); // UQ7
-        alpha = (float)(state->phase & MASK_25) * Q25TOF;
-    } else {
-        // apply phase distortion
-        const float fpos = (state->phase <= state->skew_bp)
-            ? state->skew_r1 * (float)state->phase * Q25TOF
-            : state->skew_r2 * (float)(state->phase - state->skew_bp) * Q25TOF + 64.f;
-        pos = (uint8_t)fpos;
-        alpha = fpos - pos;
-    }
     // get sample values from the stored waves
+#ifdef WTGEN_UNFOLD
+    // full period is stored
+    w11 = pw0[pos];
+    w21 = pw1[pos];
+#else
     if (!(pos & 0x40)) {
         // pos 0..63 - first half of the period
-        w11 = state->pwave[0][pos];
-        w21 = state->pwave[1][pos];
+        w11 = pw0[pos];
+        w21 = pw1[pos];
     } else {
         // pos 64..127 - second half of the period
         // the first falf is mirrored in time and amplitude
         const uint8_t posr = ~pos & 0x3F;
-        w11 = ~state->pwave[0][posr];
-        w21 = ~state->pwave[1][posr];
+        w11 = ~pw0[posr];
+        w21 = ~pw1[posr];
     }
-    pos2 = (pos + 1) & 0x7F;
-    if (!(pos2 & 0x40)) {
-        // pos 0..63 - first half of the period
-        w12 = state->pwave[0][pos2];
-        w22 = state->pwave[1][pos2];
+#endif
+    // interpolate between waves
+    return (1.f - alpha_w) * w11 + alpha_w * w21 - 127.5f;
+}
+
+/*  read_wavecycles
+    Read n samples from the blended wave cache, with sample interpolation.
+    phase, step: read phase and its step
+    Returns: read phase after the last sample
+*/
+_INLINE uq7_25_t read_wavecycles(WtGenState* state, wtsample_t* __restrict out, uint32_t n, uq7_25_t phase,
+    uq7_25_t step)
+{
+#ifdef WTGEN_Q15
+    const uint32_t* const wp = state->wpair;
+#else
+    const float* const wc = state->wcache;
+#endif
+    wtsample_t* const out_e = out + n;
+#ifdef WTGEN_SMOOTH
+    // wave number ramp: alpha_w + alpha_off
+    const float* const wd = state->wdiff;
+    const float alpha_step = state->alpha_step;
+    float alpha_off = state->alpha_off;
+#endif
+
+#ifdef WTGEN_Q15
+    while (out != out_e) {
+        const uint32_t pos = phase >> 25; // UQ7
+        const uint32_t alpha = (phase >> 12) & 0x1FFF; // Q13
+        // y0 * 1 + (y1 - y0) * alpha: Q8.7 * Q13 = Q8.20
+        *(out++) = (int32_t)smuad(wp[pos], pkhbt(0x2000, alpha, 16));
+        phase += step;
+    }
+#else
+    while (out != out_e) {
+        const uint32_t pos = phase >> 25; // UQ7
+        const float alpha = (float)(phase & MASK_25) * Q25TOF;
+        const float y0 = wc[pos];
+#ifdef WTGEN_SMOOTH
+        *(out++) = y0 + alpha * (wc[pos + 1] - y0) + alpha_off * wd[pos];
+        alpha_off += alpha_step;
+#else
+        *(out++) = y0 + alpha * (wc[pos + 1] - y0);
+#endif
+        phase += step;
+    }
+#ifdef WTGEN_SMOOTH
+    state->alpha_off = alpha_off;
+#endif
+#endif
+    return phase;
+}
+
+/*  read_wave_block
+    Read n samples from the blended wave cache, with the phase skew if it is set,
+    and advance the phase.
+*/
+_INLINE void read_wave_block(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
+{
+    const uq7_25_t step = state->step;
+    uq7_25_t phase = state->phase;
+
+    if (!state->skew_bp) {
+        phase = read_wavecycles(state, out, n, phase, step);
     } else {
-        // pos 64..127 - second half of the period
-        // the first falf is mirrored in time and amplitude
-        const uint8_t pos2r = ~pos2 & 0x3F;
-        w12 = ~state->pwave[0][pos2r];
-        w22 = ~state->pwave[1][pos2r];
+        // apply phase distortion: the read phase has a constant step up to the breakpoint
+        // and another one up to the period end, it is resynchronized with the phase at each switch
+        while (n) {
+            uq7_25_t rphase, rstep;
+            const uint32_t k = skew_segment(state, phase, n, &rphase, &rstep);
+            read_wavecycles(state, out, k, rphase, rstep);
+            phase += k * step;
+            out += k;
+            n -= k;
+        }
     }
-    // interpolate between samples
-    out1 = (1.f - alpha) * w11 + alpha * w12;
-    out2 = (1.f - alpha) * w21 + alpha * w22;
-    // interpolate between waves
-    y = (1.f - state->alpha_w) * out1 + state->alpha_w * out2 - 127.f;
+    state->phase = phase;
+}
 
-    state->phase += state->step;
-    return y;
+/*  generate_wavecycles
+    Calculate a block of samples.
+    Uses wavetables with memory waves.
+    Interpolate sample values from the blended wave cache.
+    Output: sample values, -127.5 to 127.5 (WTSAMPLE)
+*/
+_INLINE void generate_wavecycles(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
+{
+#ifdef WTGEN_SMOOTH
+    // wave number ramp, in segments with a single pair of waves
+    while (state->ramp_left && n) {
+        const uint32_t k = ramp_segment(state, n);
+        read_wave_block(state, out, k);
+        advance_ramp(state, k);
+        out += k;
+        n -= k;
+    }
+#endif
+    read_wave_block(state, out, n);
 }
 
 /*  generate_wavecycles_noint
-    Calculate and return one sample value.
+    Calculate a block of samples.
     Uses wavetables with memory waves.
     Do not interpolate between samples
-    Returns: sample value, floating point, -127.5 to 127.5
+    Output: sample values, -127.5 to 127.5 (WTSAMPLE)
 */
-_INLINE float generate_wavecycles_noint(WtGenState* state)
+_INLINE void generate_wavecycles_noint(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
 {
-    float y;
-    uint8_t w11, w21;
-    uint8_t pos; // integer sample position, 0..128
+    const uint8_t* const pw0 = state->pwave[0];
+    const uint8_t* const pw1 = state->pwave[1];
+    const float alpha_w = state->alpha_w;
+    const uq7_25_t step = state->step;
+    uq7_25_t phase = state->phase;
+    wtsample_t* const out_e = out + n;
 
     if (!state->skew_bp) {
-        pos = (uint8_t)(state->phase >> 25); // UQ7
-    } else {
-        // apply phase distortion
-        const float fpos = (state->phase <= state->skew_bp)
-            ? state->skew_r1 * (float)state->phase * Q25TOF
-            : state->skew_r2 * (float)(state->phase - state->skew_bp) * Q25TOF + 64.f;
-        pos = (uint8_t)fpos;
-    }
-    // get sample values from the stored waves
-    if (!(pos & 0x40)) {
-        // pos 0..63 - first half of the period
-        w11 = state->pwave[0][pos];
-        w21 = state->pwave[1][pos];
+        while (out != out_e) {
+            const uint8_t pos = (uint8_t)(phase >> 25); // UQ7
+            *(out++) = WTSAMPLE(read_wavecycles_noint(pw0, pw1, pos, alpha_w));
+            phase += step;
+        }
     } else {
-        // pos 64..127 - second half of the period
-        // the first falf is mirrored in time and amplitude
-        const uint8_t posr = ~pos & 0x3F;
-        w11 = ~state->pwave[0][posr];
-        w21 = ~state->pwave[1][posr];
+        // apply phase distortion, as in generate_wavecycles
+        while (out != out_e) {
+            uq7_25_t rphase, rstep;
+            const uint32_t k = skew_segment(state, phase, (uint32_t)(out_e - out), &rphase, &rstep);
+            wtsample_t* const seg_e = out + k;
+            while (out != seg_e) {
+                *(out++) = WTSAMPLE(read_wavecycles_noint(pw0, pw1, (uint8_t)(rphase >> 25), alpha_w));
+                rphase += rstep;
+            }
+            phase += k * step;
+        }
     }
-    // interpolate between waves
-    y = (1.f - state->alpha_w) * w11 + state->alpha_w * w21 - 127.5f;
-    state->phase += state->step;
-    return y;
+    state->phase = phase;
 }
 
 /*  generate_wt28
-    Calculate and return one sample value from wavetable 28 (sync).
+    Calculate a block of samples from wavetable 28 (sync).
     Interpolate between samples.
-    Returns: sample value, floating point, -127.5 to 127.5
+    The ramp is reset sync_step times per period: y = -64 + 128 * frac(u), u = pos * sync_step / 128,
+    computed in constant time. The resets (jump of -128) and the period end (jump of 2 * sync_end)
+    are band-limited with PolyBLEP.
+    Output: sample values, -127.5 to 127.5 (WTSAMPLE)
 */
-_INLINE float generate_wt28(WtGenState* state)
+_INLINE void generate_wt28(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
 {
-    // (no aliasing protection)
-    float posf = (float)state->phase * Q25TOF; // phase 0..128
-    // subtract synched periods
-    while (posf >= state->sync_period)
-        posf -= state->sync_period;
-    const float y = -64.f + posf * state->sync_step;
-    // TODO: PolyBlep, at 0 and at each sync point
-    // (needs the value at 128 for step length)
-    state->phase += state->step;
-    return y;
+    const float sync_step = state->sync_step;
+    const uint32_t sync_count = state->sync_count;
+    const float sync_end = state->sync_end;
+    const float u_scale = sync_step * (Q25TOF / MAX_PHASE); // phase to sync periods
+    const float phase_step = (float)(state->step) * Q25TOF;
+    const float recip_step = state->recip_step;
+    const float u_step = phase_step * sync_step * (1.f / MAX_PHASE); // step in sync periods
+    const float recip_u_step = recip_step * MAX_PHASE / sync_step;
+    const uq7_25_t step = state->step;
+    uq7_25_t phase = state->phase;
+    wtsample_t* const out_e = out + n;
+
+    while (out != out_e) {
+        const float pos = (float)phase * Q25TOF; // phase 0..128
+        const float u = (float)phase * u_scale; // position in sync periods
+        const uint32_t k = (uint32_t)u; // number of the sync period
+        const float f = u - (float)k; // position in the sync period
+        float y = -64.f + 128.f * f;
+        // reset inside the wave period
+        if ((f < u_step) && k && (k <= sync_count)) {
+            const float t = f * recip_u_step;
+            y -= (t + t - t * t - 1.f) * 64.f;
+        } else if ((f > 1.f - u_step) && (k < sync_count)) {
+            const float t = (f - 1.f) * recip_u_step;
+            y -= (t * t + t + t + 1.f) * 64.f;
+        }
+        // period end
+        if (pos < phase_step) {
+            const float t = pos * recip_step;
+            y += (t + t - t * t - 1.f) * sync_end;
+        } else if (pos > MAX_PHASE - phase_step) {
+            const float t = (pos - MAX_PHASE) * recip_step;
+            y += (t * t + t + t + 1.f) * sync_end;
+        }
+        *(out++) = WTSAMPLE(y);
+        phase += step;
+    }
+    state->phase = phase;
 }
 
 /*  generate_wt28_noint
-    Calculate and return one sample value from wavetable 28 (sync).
+    Calculate a block of samples from wavetable 28 (sync).
     Do not interpolate between samples.
-    Returns: sample value, floating point, -127.5 to 127.5
+    Output: sample values, -127.5 to 127.5 (WTSAMPLE)
 */
-_INLINE float generate_wt28_noint(WtGenState* state)
+_INLINE void generate_wt28_noint(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
 {
     // (no aliasing protection)
-    float posf = (float)(state->phase >> 25); // phase 0..128
-    // subtract synched periods
-    while (posf >= state->sync_period)
-        posf -= state->sync_period;
-    const float y = -64.f + posf * state->sync_step;
-    // TODO: PolyBlep, at 0 and at each sync point
-    // (needs the value at 128 for step length)
-    state->phase += state->step;
-    return y;
+    const float u_scale = state->sync_step * (1.f / MAX_PHASE); // sample position to sync periods
+    const uq7_25_t step = state->step;
+    uq7_25_t phase = state->phase;
+    wtsample_t* const out_e = out + n;
+
+    while (out != out_e) {
+        const float u = (float)(phase >> 25) * u_scale; // phase 0..128, in sync periods
+        const float f = u - (float)(uint32_t)u; // position in the sync period
+        *(out++) = WTSAMPLE(-64.f + 128.f * f);
+        phase += step;
+    }
+    state->phase = phase;
 }
 
+/*  add_minblep
+    Add the minBLEP residual of a transition to the pending residual.
+    res: residual ring buffer, BLEP_LEN samples, pos: its next sample
+    t: time from the transition to the next sample, in samples, 0..1
+    h: height of the transition
+*/
+_INLINE void add_minblep(float* __restrict res, uint32_t pos, float t, float h)
+{
+    const float tp = t * BLEP_PHASES;
+    uint32_t row = (uint32_t)tp;
+    if (row >= BLEP_PHASES)
+        row = BLEP_PHASES - 1;
+    // linear interpolation between the rows, scaled by h
+    const float c1 = h * (tp - (float)row);
+    const float c0 = h - c1;
+    const float* const r0 = MINBLEP[row];
+    const float* const r1 = MINBLEP[row + 1];
+    const uint32_t n1 = BLEP_LEN - pos; // samples up to the end of the buffer
+    uint32_t m;
+    for (m = 0; m < n1; m++)
+        res[pos + m] += c0 * r0[m] + c1 * r1[m];
+    for (m = 0; m < pos; m++)
+        res[m] += c0 * r0[n1 + m] + c1 * r1[n1 + m];
+}
+
+/*
+    Wavetable 29 cost bound
+    The minBLEP costs 2 * BLEP_LEN multiply-adds per transition, so its cost per block grows with the pitch.
+    If the period is shorter than WT29_MINBLEP_PERIOD samples (more than one transition per BLEP_LEN samples),
+    the step wave is generated with PolyBLEP, in constant time per sample, as before the minBLEP.
+*/
+#define WT29_MINBLEP_PERIOD (2 * BLEP_LEN)
+#define WT29_MINBLEP_MAX_STEP ((uq7_25_t)(0x100000000ULL / WT29_MINBLEP_PERIOD)) // one period: 2**32
+
 /*  generate_wt29
-    Calculate and return one sample value from wavetable 29 (step).
+    Calculate a block of samples from wavetable 29 (step).
     Interpolate between samples.
-    Returns: sample value, floating point, -127.5 to 127.5
+    Event based: the output is a constant level between the two transitions of the period
+    (up at 0, down at the edge), the number of samples to the next transition is computed directly.
+    At each transition, the minBLEP residual is added to the next BLEP_LEN samples,
+    the part that does not fit in the block is kept in the blep state.
+    High pitches (step above WT29_MINBLEP_MAX_STEP) are generated by generate_wt29_polyblep.
+    Output: sample values, -127.5 to 127.5 (WTSAMPLE)
 */
-_INLINE float generate_wt29(WtGenState* state)
+_INLINE void generate_wt29(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
+{
+    if (state->step > WT29_MINBLEP_MAX_STEP) {
+        generate_wt29_polyblep(state, out, n);
+        return;
+    }
+    const uq7_25_t edge = (uq7_25_t)((64.f + state->alpha_w) * 33554432.f); // transition high->low, UQ7.25
+    const uq7_25_t step = state->step;
+    const float frac_scale = state->recip_step * Q25TOF; // phase to samples
+    float* const res = state->blep.res;
+    uint32_t bp = state->blep.pos;
+    uint32_t left = state->blep.left;
+    uq7_25_t phase = state->phase;
+    uint32_t i = 0;
+
+    while (i < n) {
+        const int high = phase < edge;
+        const float level = high ? 32.f : -32.f;
+        const uq7_25_t bound = high ? edge : 0; // next transition
+        const uq7_25_t d = bound - phase; // distance to the transition, > 0
+        // samples before the transition, ceil(d / step),
+        // estimated in floating point and corrected by one if needed
+        uint32_t k = step ? (uint32_t)((float)d * frac_scale + 1.f) : n;
+        if ((uint64_t)(k - 1) * step >= d)
+            k--;
+        else if ((uint64_t)k * step < d)
+            k++;
+        const uint32_t seg = (k < n - i) ? k : n - i;
+        const uint32_t seg_e = i + seg;
+        // pending residual (cleared after use), then the constant level
+        for (; (i < seg_e) && left; left--) {
+            out[i++] = WTSAMPLE(level + res[bp]);
+            res[bp] = 0.f;
+            bp = (bp + 1) & (BLEP_LEN - 1);
+        }
+        while (i < seg_e)
+            out[i++] = WTSAMPLE(level);
+        phase += seg * step;
+        if (seg < k)
+            break; // end of the block before the transition
+        // transition between the last two samples, phase is past it
+        add_minblep(res, bp, (float)(phase - bound) * frac_scale, high ? -64.f : 64.f);
+        left = BLEP_LEN;
+    }
+    state->blep.pos = (uint8_t)bp;
+    state->blep.left = (uint8_t)left;
+    state->phase = phase;
+}
+
+/*  generate_wt29_polyblep
+    Calculate a block of samples from wavetable 29 (step), for high pitches.
+    Interpolate between samples.
+    The transitions are band-limited with PolyBLEP, constant time per sample.
+    The pending minBLEP residual (after a pitch change) is added to the first samples.
+    Output: sample values, -127.5 to 127.5 (WTSAMPLE)
+*/
+_INLINE void generate_wt29_polyblep(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
 {
-    float y;
-    // wavetable 29: step wave (with PolyBLEP)
-    const float pos = (float)state->phase * Q25TOF;
     const float phase_step = (float)(state->step) * Q25TOF;
+    const float recip_step = state->recip_step;
     const float edge = 64.f + state->alpha_w; // transition high->low
-    y = (pos < edge) ? 32.f : -32.f;
-    if (pos < phase_step) {
-        const float t = pos * state->recip_step;
-        y += (t + t - t * t - 1.f) * 32.f;
-    } else if (((edge - phase_step) < pos) && (pos < edge)) {
-        const float t = (pos - edge) * state->recip_step;
-        y -= (t * t + t + t + 1.f) * 32.f;
-    } else if ((edge <= pos) && (pos < (edge + phase_step))) {
-        const float t = (pos - edge) * state->recip_step;
-        y -= (t + t - t * t - 1.f) * 32.f;
-    } else if (pos > 128 - phase_step) {
-        const float t = (pos - 128.f) * state->recip_step;
-        y += (t * t + t + t + 1.f) * 32.f;
-    }
-    state->phase += state->step;
-    return y;
+    const uq7_25_t step = state->step;
+    float* const res = state->blep.res;
+    uint32_t bp = state->blep.pos;
+    uint32_t left = state->blep.left;
+    uq7_25_t phase = state->phase;
+    wtsample_t* const out_e = out + n;
+
+    while (out != out_e) {
+        const float pos = (float)phase * Q25TOF;
+        float y = (pos < edge) ? 32.f : -32.f;
+        if (pos < phase_step) {
+            const float t = pos * recip_step;
+            y += (t + t - t * t - 1.f) * 32.f;
+        } else if (((edge - phase_step) < pos) && (pos < edge)) {
+            const float t = (pos - edge) * recip_step;
+            y -= (t * t + t + t + 1.f) * 32.f;
+        } else if ((edge <= pos) && (pos < (edge + phase_step))) {
+            const float t = (pos - edge) * recip_step;
+            y -= (t + t - t * t - 1.f) * 32.f;
+        } else if (pos > MAX_PHASE - phase_step) {
+            const float t = (pos - MAX_PHASE) * recip_step;
+            y += (t * t + t + t + 1.f) * 32.f;
+        }
+        *(out++) = WTSAMPLE(y);
+        phase += step;
+    }
+    // pending minBLEP residual (cleared after use)
+    out = out_e - n;
+    for (; left && (out != out_e); left--) {
+        *(out++) += WTSAMPLE(res[bp]);
+        res[bp] = 0.f;
+        bp = (bp + 1) & (BLEP_LEN - 1);
+    }
+    state->blep.pos = (uint8_t)bp;
+    state->blep.left = (uint8_t)left;
+    state->phase = phase;
 }
 
 /*  generate_wt29_noint
-    Calculate and return one sample value from wavetable 29 (step).
+    Calculate a block of samples from wavetable 29 (step).
     Do not interpolate between samples.
-    Returns: sample value, floating point, -127.5 to 127.5
+    Output: sample values, -127.5 to 127.5 (WTSAMPLE)
 */
-_INLINE float generate_wt29_noint(WtGenState* state)
+_INLINE void generate_wt29_noint(WtGenState* state, wtsample_t* __restrict out, uint32_t n)
 {
     // wavetable 29: step wave (no antialiasing)
-    const uint8_t pos = (uint8_t)(state->phase >> 25);
     const uint8_t edge = 64 + (uint8_t)state->alpha_w; // transition high->low
-    const float y = (pos < edge) ? 32.f : -32.f;
-    state->phase += state->step;
-    return y;
+    const uq7_25_t step = state->step;
+    uq7_25_t phase = state->phase;
+    wtsample_t* const out_e = out + n;
+
+    while (out != out_e) {
+        const uint8_t pos = (uint8_t)(phase >> 25);
+        *(out++) = (pos < edge) ? WTSAMPLE(32.f) : WTSAMPLE(-32.f);
+        phase += step;
+    }
+    state->phase = phase;
 }
 
 #endif
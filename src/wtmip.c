@@ -0,0 +1,55 @@
+/*
+ * wtmip.c
+ * Band-limited versions (mipmaps) of the PPG waves.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include "wtmip.h"
+
+#ifdef WTGEN_MIPMAP
+
+#include <math.h>
+
+float WAVES_MIP[NWAVES][MIP_LEVELS - 1][64];
+
+static int g_mip_ready = 0;
+
+/*  wtmip_init
+    Compute the band-limited waves from WAVES.
+    The full period of a wave is antisymmetric around its center,
+    so it is a sum of sine components with phases referenced to the center:
+    x(p) = sum_k b_k * sin(2*pi*k*(p - 63.5)/128).
+    Level L is the sum of the components 1 to (64 >> L).
+*/
+void wtmip_init(void)
+{
+    const double w0 = 6.283185307179586 / 128.;
+    double b[33]; // sine coefficients, harmonics 1..32
+    int nw, k, p, level;
+
+    if (g_mip_ready)
+        return;
+
+    for (nw = 0; nw < NWAVES; nw++) {
+        // analysis: only the first half is needed, the second half is antisymmetric
+        for (k = 1; k <= 32; k++) {
+            double acc = 0;
+            for (p = 0; p < 64; p++)
+                acc += (double)(2 * WAVES[nw][p] - 255) * sin(w0 * k * (2 * p - 127) / 2);
+            b[k] = acc / 64; // (2/N, both halves) * (1/2 from the doubled sample value)
+        }
+        // synthesis of the band-limited versions
+        for (level = 1; level < MIP_LEVELS; level++) {
+            const int nharm = 64 >> level;
+            for (p = 0; p < 64; p++) {
+                double acc = 0;
+                for (k = 1; k <= nharm; k++)
+                    acc += b[k] * sin(w0 * k * (2 * p - 127) / 2);
+                WAVES_MIP[nw][level - 1][p] = (float)acc;
+            }
+        }
+    }
+    g_mip_ready = 1;
+}
+
+#endif
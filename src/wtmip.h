@@ -0,0 +1,51 @@
+#pragma once
+#ifndef _WTMIP_H
+#define _WTMIP_H
+
+/*
+ * wtmip.h
+ * Band-limited versions (mipmaps) of the PPG waves.
+ * Each wave is stored in MIP_LEVELS versions. Level 0 is the original wave (all 64 harmonics),
+ * level L keeps only the harmonics 1 to (64 >> L), so that it may be played
+ * without aliasing at frequencies up to (srate / 2) / (64 >> L).
+ * The tables need c.a. 330 kB of memory, so they are available only in desktop builds
+ * (WTGEN_MIPMAP defined). They are computed from WAVES once, by wtmip_init(),
+ * before any sound is generated.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include "wtdef.h"
+
+#define MIP_LEVELS 7 // number of band-limited versions, including the original wave
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef WTGEN_MIPMAP
+
+#ifdef USER_TARGET_PLATFORM
+#error "Band-limited waves do not fit in the memory of logue oscillators"
+#endif
+
+/*
+ * Band-limited waves, levels 1 to MIP_LEVELS-1.
+ * Only the first half of the period, as in WAVES. The second half is obtained
+ * by mirroring in time and amplitude (the band-limited waves keep the symmetry).
+ * Sample values are centered around zero, range c.a. -140..140 (the ripple
+ * caused by removing the harmonics may exceed the original range).
+ */
+extern float WAVES_MIP[NWAVES][MIP_LEVELS - 1][64];
+
+/*  wtmip_init
+    Compute the band-limited waves. Does nothing if they are already computed.
+*/
+void wtmip_init(void);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
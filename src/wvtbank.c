@@ -0,0 +1,315 @@
+/*
+ * wvtbank.c
+ * A bank of WvTable voices, mixed into a single output.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include <string.h>
+#include "wvtbank.h"
+
+#if defined(WVTBANK_AVX2) || defined(WVTBANK_SSE2)
+#include <immintrin.h>
+#elif defined(WVTBANK_NEON)
+#include <arm_neon.h>
+#endif
+
+// float output scale, the same as Q31 output of wvt_cycle divided by 2**31
+#define BANK_OUT_SCALE (15000000.f / 2147483648.f)
+
+// the wave caches are addressed by int32 byte offsets from the start of the bank
+_Static_assert(sizeof(WvTableBank) <= INT32_MAX, "WvTableBank too large for int32 lane offsets");
+// sample of a lane: base - start of the bank, offset - byte offset
+#define LANE_SAMPLE(base, offset) (*(const float*)((base) + (offset)))
+
+/*  wvtbank_init
+    Initialize the bank.
+*/
+void wvtbank_init(WvTableBank* bank, uint32_t nvoices)
+{
+    uint32_t v;
+    uint16_t i;
+    bank->nvoices = (nvoices < WVTBANK_MAX_VOICES) ? nvoices : WVTBANK_MAX_VOICES;
+    for (v = 0; v < WVTBANK_MAX_VOICES; v++) {
+        wvt_init(&bank->voice[v]);
+        for (i = 0; i < k_num_user_osc_param_id; i++)
+            wvt_param(&bank->voice[v], i, 0);
+        // the factor is set by the bank, the voices must not select their own (OVS_AUTO builds)
+        bank->voice[v].params.ovs_auto = 0;
+        memset(&bank->params[v], 0, sizeof(user_osc_param_t));
+        bank->gain[v] = 0;
+    }
+    bank->ovs_log2 = bank->ovs_sel = OVS_DEFAULT_LOG2;
+    for (v = 0; v < OVS_STAGES; v++)
+        decimator_reset(&bank->dec[v]);
+}
+
+/*  set_bank_ovs
+    Set the oversampling factor of all the voices, for the output rate.
+    All the slots are updated, not only the first nvoices.
+*/
+static void set_bank_ovs(WvTableBank* bank)
+{
+    const uint8_t shift = bank->voice[0].srate_shift;
+    const uint8_t ovs_log2 = (bank->ovs_sel > shift) ? (uint8_t)(bank->ovs_sel - shift) : 0;
+    uint32_t v;
+    if (ovs_log2 != bank->ovs_log2) {
+        bank->ovs_log2 = ovs_log2;
+        for (v = 0; v < OVS_STAGES; v++)
+            decimator_reset(&bank->dec[v]);
+    }
+    for (v = 0; v < WVTBANK_MAX_VOICES; v++) {
+        // the voice keeps the factor on Note On and on a rate change
+        bank->voice[v].params.ovs_sel = bank->ovs_sel;
+        wvt_set_ovs(&bank->voice[v], ovs_log2);
+    }
+}
+
+/*  wvtbank_set_srate
+    Set the output sampling rate of all the voices.
+*/
+void wvtbank_set_srate(WvTableBank* bank, uint32_t srate)
+{
+    uint32_t v;
+    for (v = 0; v < WVTBANK_MAX_VOICES; v++)
+        wvt_set_srate(&bank->voice[v], srate);
+    set_bank_ovs(bank);
+}
+
+/*  wvtbank_noteon
+    Start a note in a voice.
+*/
+void wvtbank_noteon(WvTableBank* bank, uint32_t nvoice, uint16_t pitch, float gain)
+{
+    bank->params[nvoice].pitch = pitch;
+    wvt_noteon(&bank->voice[nvoice], &bank->params[nvoice]);
+    bank->gain[nvoice] = gain;
+}
+
+/*  wvtbank_noteoff
+    Release the note in a voice.
+*/
+void wvtbank_noteoff(WvTableBank* bank, uint32_t nvoice)
+{
+    wvt_noteoff(&bank->voice[nvoice]);
+}
+
+/*  wvtbank_param
+    Set a parameter in all the voices, including the slots above nvoices,
+    so that they do not keep stale parameters.
+*/
+void wvtbank_param(WvTableBank* bank, uint16_t index, uint16_t value)
+{
+    uint32_t v;
+    if (index == k_wvt_param_ovs) {
+        // the same factor in all the voices, no adaptive oversampling: Auto is the default factor
+        if (value == OVS_AUTO_VALUE)
+            bank->ovs_sel = OVS_DEFAULT_LOG2;
+        else
+            bank->ovs_sel = (value < OVS_MAX_LOG2) ? (uint8_t)value : OVS_MAX_LOG2;
+        set_bank_ovs(bank);
+        return;
+    }
+    for (v = 0; v < WVTBANK_MAX_VOICES; v++)
+        wvt_param(&bank->voice[v], index, value);
+}
+
+/*  generate_lanes
+    Generate the voices stored in the lane arrays and add them to the mix.
+    Same computation as generate_wavecycles, for WVTBANK_LANES voices at once.
+    nlanes: number of lanes, multiple of WVTBANK_LANES
+    mix: output buffer, the samples are added
+    n: number of samples
+*/
+static void generate_lanes(WvTableBank* bank, uint32_t nlanes, float* __restrict mix, uint32_t n)
+{
+    const char* const base = (const char*)bank;
+    uint32_t g, t;
+
+#if defined(WVTBANK_AVX2)
+    __m256 acc[GEN_BLOCK * OVS_MAX];
+    const __m256i mask = _mm256_set1_epi32(MASK_25);
+    const __m256 q25 = _mm256_set1_ps(Q25TOF);
+    for (t = 0; t < n; t++)
+        acc[t] = _mm256_setzero_ps();
+    for (g = 0; g < nlanes; g += 8) {
+        __m256i phase = _mm256_loadu_si256((const __m256i*)&bank->lane_phase[g]);
+        const __m256i step = _mm256_loadu_si256((const __m256i*)&bank->lane_step[g]);
+        const __m256i offset = _mm256_loadu_si256((const __m256i*)&bank->lane_offset[g]);
+        const __m256 gain = _mm256_loadu_ps(&bank->lane_gain[g]);
+        for (t = 0; t < n; t++) {
+            const __m256i idx = _mm256_add_epi32(offset, _mm256_slli_epi32(_mm256_srli_epi32(phase, 25), 2));
+            const __m256 y0 = _mm256_i32gather_ps((const float*)base, idx, 1);
+            const __m256 y1 = _mm256_i32gather_ps((const float*)(base + sizeof(float)), idx, 1);
+            const __m256 alpha = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(phase, mask)), q25);
+#ifdef __FMA__
+            const __m256 y = _mm256_fmadd_ps(alpha, _mm256_sub_ps(y1, y0), y0);
+            acc[t] = _mm256_fmadd_ps(gain, y, acc[t]);
+#else
+            const __m256 y = _mm256_add_ps(y0, _mm256_mul_ps(alpha, _mm256_sub_ps(y1, y0)));
+            acc[t] = _mm256_add_ps(acc[t], _mm256_mul_ps(gain, y));
+#endif
+            phase = _mm256_add_epi32(phase, step);
+        }
+        _mm256_storeu_si256((__m256i*)&bank->lane_phase[g], phase);
+    }
+    for (t = 0; t < n; t++) {
+        // horizontal sum of the lanes
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc[t]), _mm256_extractf128_ps(acc[t], 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        mix[t] += _mm_cvtss_f32(s);
+    }
+
+#elif defined(WVTBANK_SSE2)
+    // no gather instruction, the samples are loaded one by one
+    __m128 acc[GEN_BLOCK * OVS_MAX];
+    const __m128i mask = _mm_set1_epi32(MASK_25);
+    const __m128 q25 = _mm_set1_ps(Q25TOF);
+    for (t = 0; t < n; t++)
+        acc[t] = _mm_setzero_ps();
+    for (g = 0; g < nlanes; g += 4) {
+        __m128i phase = _mm_loadu_si128((const __m128i*)&bank->lane_phase[g]);
+        const __m128i step = _mm_loadu_si128((const __m128i*)&bank->lane_step[g]);
+        const __m128i offset = _mm_loadu_si128((const __m128i*)&bank->lane_offset[g]);
+        const __m128 gain = _mm_loadu_ps(&bank->lane_gain[g]);
+        for (t = 0; t < n; t++) {
+            int32_t idx[4];
+            _mm_storeu_si128((__m128i*)idx, _mm_add_epi32(offset, _mm_slli_epi32(_mm_srli_epi32(phase, 25), 2)));
+            const __m128 y0 = _mm_setr_ps(LANE_SAMPLE(base, idx[0]), LANE_SAMPLE(base, idx[1]),
+                LANE_SAMPLE(base, idx[2]), LANE_SAMPLE(base, idx[3]));
+            const __m128 y1 = _mm_setr_ps(LANE_SAMPLE(base, idx[0] + 4), LANE_SAMPLE(base, idx[1] + 4),
+                LANE_SAMPLE(base, idx[2] + 4), LANE_SAMPLE(base, idx[3] + 4));
+            const __m128 alpha = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phase, mask)), q25);
+            const __m128 y = _mm_add_ps(y0, _mm_mul_ps(alpha, _mm_sub_ps(y1, y0)));
+            acc[t] = _mm_add_ps(acc[t], _mm_mul_ps(gain, y));
+            phase = _mm_add_epi32(phase, step);
+        }
+        _mm_storeu_si128((__m128i*)&bank->lane_phase[g], phase);
+    }
+    for (t = 0; t < n; t++) {
+        __m128 s = _mm_add_ps(acc[t], _mm_movehl_ps(acc[t], acc[t]));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        mix[t] += _mm_cvtss_f32(s);
+    }
+
+#elif defined(WVTBANK_NEON)
+    float32x4_t acc[GEN_BLOCK * OVS_MAX];
+    const uint32x4_t mask = vdupq_n_u32(MASK_25);
+    for (t = 0; t < n; t++)
+        acc[t] = vdupq_n_f32(0);
+    for (g = 0; g < nlanes; g += 4) {
+        uint32x4_t phase = vld1q_u32(&bank->lane_phase[g]);
+        const uint32x4_t step = vld1q_u32(&bank->lane_step[g]);
+        const int32x4_t offset = vld1q_s32(&bank->lane_offset[g]);
+        const float32x4_t gain = vld1q_f32(&bank->lane_gain[g]);
+        for (t = 0; t < n; t++) {
+            int32_t idx[4];
+            float s0[4], s1[4];
+            int l;
+            vst1q_s32(idx, vaddq_s32(offset, vreinterpretq_s32_u32(vshlq_n_u32(vshrq_n_u32(phase, 25), 2))));
+            for (l = 0; l < 4; l++) {
+                s0[l] = LANE_SAMPLE(base, idx[l]);
+                s1[l] = LANE_SAMPLE(base, idx[l] + 4);
+            }
+            const float32x4_t y0 = vld1q_f32(s0);
+            const float32x4_t y1 = vld1q_f32(s1);
+            const float32x4_t alpha = vmulq_n_f32(vcvtq_f32_u32(vandq_u32(phase, mask)), Q25TOF);
+            const float32x4_t y = vmlaq_f32(y0, alpha, vsubq_f32(y1, y0));
+            acc[t] = vmlaq_f32(acc[t], gain, y);
+            phase = vaddq_u32(phase, step);
+        }
+        vst1q_u32(&bank->lane_phase[g], phase);
+    }
+    for (t = 0; t < n; t++) {
+        const float32x2_t s = vadd_f32(vget_low_f32(acc[t]), vget_high_f32(acc[t]));
+        mix[t] += vget_lane_f32(vpadd_f32(s, s), 0);
+    }
+
+#else
+    for (g = 0; g < nlanes; g++) {
+        const float* const wc = &LANE_SAMPLE(base, bank->lane_offset[g]);
+        const uint32_t step = bank->lane_step[g];
+        const float gain = bank->lane_gain[g];
+        uint32_t phase = bank->lane_phase[g];
+        for (t = 0; t < n; t++) {
+            const uint32_t pos = phase >> 25;
+            const float alpha = (float)(phase & MASK_25) * Q25TOF;
+            const float y0 = wc[pos];
+            mix[t] += gain * (y0 + alpha * (wc[pos + 1] - y0));
+            phase += step;
+        }
+        bank->lane_phase[g] = phase;
+    }
+#endif
+}
+
+/*  wvtbank_render
+    Generate the mix of all the voices.
+    The voices are updated and generated in sub-blocks of MOD_STRIDE samples, as in wvt_cycle,
+    the mix is decimated in blocks of GEN_BLOCK samples.
+*/
+void wvtbank_render(WvTableBank* bank, float* out, uint32_t nframes)
+{
+    float mix[GEN_BLOCK * OVS_MAX];
+    float buf[GEN_BLOCK * OVS_MAX];
+
+    while (nframes) {
+        const uint32_t n = (nframes < GEN_BLOCK) ? nframes : GEN_BLOCK;
+        const uint8_t ovs_log2 = bank->ovs_log2;
+        uint32_t v, i, j, k;
+
+        for (i = 0; i < (n << ovs_log2); i++)
+            mix[i] = 0;
+
+        for (j = 0; j < n; j += k) {
+            float* const pmix = mix + (j << ovs_log2);
+            uint32_t nlanes = 0;
+            k = (n - j < MOD_STRIDE) ? n - j : MOD_STRIDE;
+            const uint32_t novs = k << ovs_log2;
+
+            // update the voices, collect the voices generated in parallel,
+            // generate the other ones
+            for (v = 0; v < bank->nvoices; v++) {
+                const float gain = bank->gain[v];
+                WtGenState* const gen = &bank->voice[v].gen;
+                if (gain == 0)
+                    continue;
+                wvt_update(&bank->voice[v], &bank->params[v], k);
+                if (wtgen_uses_cache(gen) && !gen->skew_bp && !wtgen_ramping(gen)) {
+                    bank->lane_phase[nlanes] = gen->phase;
+                    bank->lane_step[nlanes] = gen->step;
+                    bank->lane_offset[nlanes] = (int32_t)((const char*)gen->wcache - (const char*)bank);
+                    bank->lane_gain[nlanes] = gain;
+                    bank->lane_voice[nlanes] = (uint8_t)v;
+                    nlanes++;
+                } else {
+                    generate_block(gen, buf, novs);
+                    for (i = 0; i < novs; i++)
+                        pmix[i] += gain * buf[i];
+                }
+            }
+
+            if (nlanes) {
+                // fill the unused lanes with silent voices
+                const uint32_t nused = nlanes;
+                while (nlanes % WVTBANK_LANES) {
+                    bank->lane_phase[nlanes] = 0;
+                    bank->lane_step[nlanes] = 0;
+                    bank->lane_offset[nlanes] = (int32_t)((const char*)bank->voice[0].gen.wcache - (const char*)bank);
+                    bank->lane_gain[nlanes] = 0;
+                    nlanes++;
+                }
+                generate_lanes(bank, nlanes, pmix, novs);
+                for (i = 0; i < nused; i++)
+                    bank->voice[bank->lane_voice[i]].gen.phase = bank->lane_phase[i];
+            }
+        }
+
+        // decimate the mix, in place
+        decimator_cascade(bank->dec, mix, n, bank->ovs_log2);
+        for (i = 0; i < n; i++)
+            out[i] = mix[i] * BANK_OUT_SCALE;
+        out += n;
+        nframes -= n;
+    }
+}
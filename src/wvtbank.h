@@ -0,0 +1,113 @@
+#pragma once
+#ifndef _WVTBANK_H
+#define _WVTBANK_H
+
+/*
+ * wvtbank.h
+ * A bank of WvTable voices, mixed into a single output.
+ * The voices that read the blended wave cache (modes 1 and 2 of the memory wavetables,
+ * without skew) are generated together, one voice per SIMD lane.
+ * Their phase, phase step, gain and wave cache offset are kept in arrays (structure of arrays),
+ * the wave cache already contains the waves blended with alpha_w.
+ * The other voices (wavetables 28 and 29, mode 3, skew, wave number ramps) are generated one by one.
+ * The voices are mixed before the decimation, so a single decimator is used for the whole bank.
+ * SIMD: AVX2 (8 lanes, if compiled with -mavx2), SSE2 or NEON (4 lanes), scalar otherwise
+ * or if WVTBANK_SCALAR is defined (for testing the scalar code on any host).
+ * The oversampling factor is common to the whole bank (a single decimator).
+ * Adaptive oversampling (OVS_AUTO_VALUE) is not available, the bank uses the default factor instead.
+ * Desktop builds only.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include "wvtvoice.h"
+
+#ifdef USER_TARGET_PLATFORM
+#error "Voice banks are not intended for the logue oscillators"
+#endif
+#ifdef WTGEN_Q15
+#error "Voice banks read the float wave cache, WTGEN_Q15 is not supported"
+#endif
+
+#define WVTBANK_MAX_VOICES 64 // maximum number of voices in a bank
+
+// SIMD instruction set of the lane generator
+#if defined(WVTBANK_SCALAR)
+#elif defined(__AVX2__)
+#define WVTBANK_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#define WVTBANK_SSE2
+#elif defined(__ARM_NEON)
+#define WVTBANK_NEON
+#endif
+
+#if defined(WVTBANK_AVX2)
+#define WVTBANK_LANES 8 // number of voices generated in parallel
+#else
+#define WVTBANK_LANES 4
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    WvTableVoice voice[WVTBANK_MAX_VOICES]; // voices
+    user_osc_param_t params[WVTBANK_MAX_VOICES]; // realtime parameters of the voices (pitch, shape LFO)
+    float gain[WVTBANK_MAX_VOICES]; // output gain of the voices, 0: voice is not generated
+    uint32_t nvoices; // number of voices in the bank
+    // voices generated in parallel, filled for each sub-block (MOD_STRIDE samples)
+    uint32_t lane_phase[WVTBANK_MAX_VOICES + WVTBANK_LANES]; // phase, UQ7.25
+    uint32_t lane_step[WVTBANK_MAX_VOICES + WVTBANK_LANES]; // phase step, UQ7.25
+    int32_t lane_offset[WVTBANK_MAX_VOICES + WVTBANK_LANES]; // wave cache byte offset from the start of the bank
+    float lane_gain[WVTBANK_MAX_VOICES + WVTBANK_LANES]; // output gain
+    uint8_t lane_voice[WVTBANK_MAX_VOICES]; // voice number
+    DecimatorState dec[OVS_STAGES]; // decimator stages of the mix
+    uint8_t ovs_log2; // oversampling factor of all the voices, log2
+    uint8_t ovs_sel; // selected oversampling factor at 48 kHz, log2
+} WvTableBank;
+
+/*  wvtbank_init
+    Initialize the bank. All the voices are silent, the parameters are set to zero values.
+    nvoices: number of voices, up to WVTBANK_MAX_VOICES
+*/
+void wvtbank_init(WvTableBank* bank, uint32_t nvoices);
+
+/*  wvtbank_set_srate
+    Set the output sampling rate of all the voices (see wvt_set_srate).
+    srate: sampling rate in Hz
+*/
+void wvtbank_set_srate(WvTableBank* bank, uint32_t srate);
+
+/*  wvtbank_noteon
+    Start a note in a voice.
+    nvoice: voice number
+    pitch: note pitch, UQ8.8
+    gain: output gain of the voice
+*/
+void wvtbank_noteon(WvTableBank* bank, uint32_t nvoice, uint16_t pitch, float gain);
+
+/*  wvtbank_noteoff
+    Release the note in a voice. The voice is generated until its gain is set to zero.
+*/
+void wvtbank_noteoff(WvTableBank* bank, uint32_t nvoice);
+
+/*  wvtbank_param
+    Set a parameter in all the voices (see wvt_param).
+    The oversampling factor (k_wvt_param_ovs) is common to the whole bank.
+    OVS_AUTO_VALUE selects the default factor (OVS_DEFAULT_LOG2): with a single decimator,
+    the factor cannot follow the pitch without clicks in the other voices.
+*/
+void wvtbank_param(WvTableBank* bank, uint16_t index, uint16_t value);
+
+/*  wvtbank_render
+    Generate the mix of all the voices with nonzero gain.
+    out: output buffer, float, scaled as the Q31 output of wvt_cycle
+    nframes: number of samples to generate
+*/
+void wvtbank_render(WvTableBank* bank, float* out, uint32_t nframes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
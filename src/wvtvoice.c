@@ -0,0 +1,577 @@
+/*
+ * wvtvoice.c
+ * A single instance (voice) of the WvTable oscillator.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include "wvtvoice.h"
+
+// Envelope LUT: parameter (0.100) to rate
+// tau = 0.1 * exp(0.046 * par)
+const uint32_t ENV_LUT[101] = { 0x80000000, 0x6850f, 0x63a05, 0x5f25b, 0x5adea, 0x56c8c, 0x52e1f, 0x4f280, 0x4b990,
+    0x4832f, 0x44f40, 0x41da6, 0x3ee47, 0x3c10a, 0x395d5, 0x36c91, 0x34529, 0x31f86, 0x2fb94, 0x2d940, 0x2b876, 0x29927,
+    0x27b3f, 0x25eb0, 0x24369, 0x2295d, 0x2107c, 0x1f8ba, 0x1e209, 0x1cc5d, 0x1b7aa, 0x1a3e6, 0x19105, 0x17efe, 0x16dc6,
+    0x15d54, 0x14da0, 0x13ea0, 0x1304d, 0x1229f, 0x1158e, 0x10913, 0xfd28, 0xf1c7, 0xe6e8, 0xdc87, 0xd29c, 0xc924,
+    0xc019, 0xb777, 0xaf37, 0xa756, 0x9fd1, 0x98a1, 0x91c5, 0x8b37, 0x84f5, 0x7efa, 0x7945, 0x73d1, 0x6e9c, 0x69a3,
+    0x64e3, 0x605a, 0x5c05, 0x57e2, 0x53ef, 0x5029, 0x4c8e, 0x491d, 0x45d4, 0x42b0, 0x3fb0, 0x3cd3, 0x3a17, 0x377b,
+    0x34fc, 0x329a, 0x3054, 0x2e28, 0x2c15, 0x2a19, 0x2835, 0x2666, 0x24ac, 0x2306, 0x2173, 0x1ff2, 0x1e82, 0x1d23,
+    0x1bd4, 0x1a93, 0x1962, 0x183e, 0x1727, 0x161c, 0x151e, 0x142b, 0x1342, 0x1265, 0x1191 };
+
+// LFO rate LUT: parameter (0..100) to rate (UQ32)
+// rate = 0.25 * (exp((log(9)/50) * par) - 1) = 0.25 * (exp(0.0.043944 * par) - 1)
+// 0: 0 s, 50: 2 s, 100: 20 s
+const uint32_t LFO_LUT[101] = { 0, 0x3ed, 0x807, 0xc50, 0x10cb, 0x1579, 0x1a5d, 0x1f79, 0x24d0, 0x2a64, 0x3039, 0x3650,
+    0x3cae, 0x4354, 0x4a48, 0x518b, 0x5922, 0x6110, 0x6959, 0x7201, 0x7b0d, 0x8482, 0x8e62, 0x98b5, 0xa37e, 0xaec3,
+    0xba8a, 0xc6d8, 0xd3b4, 0xe124, 0xef2e, 0xfdda, 0x10d2e, 0x11d33, 0x12df0, 0x13f6d, 0x151b4, 0x164cc, 0x178c1,
+    0x18d9a, 0x1a364, 0x1ba28, 0x1d1f2, 0x1eace, 0x204c7, 0x21fec, 0x23c48, 0x259eb, 0x278e2, 0x2993d, 0x2bb0d, 0x2de61,
+    0x3034c, 0x329e0, 0x3522f, 0x37c4d, 0x3a850, 0x3d64d, 0x4065b, 0x43892, 0x46d0a, 0x4a3de, 0x4dd28, 0x51905, 0x55792,
+    0x598ef, 0x5dd3c, 0x6249a, 0x66f2d, 0x6bd19, 0x70e86, 0x7639b, 0x7bc83, 0x81969, 0x87a7b, 0x8dfea, 0x949e8, 0x9b8a8,
+    0xa2c62, 0xaa54f, 0xb23ab, 0xba7b4, 0xc31ab, 0xcc1d5, 0xd5879, 0xdf5e2, 0xe9a5d, 0xf463b, 0xff9d2, 0x10b57b,
+    0x117991, 0x124677, 0x131c91, 0x13fc4a, 0x14e60f, 0x15da55, 0x16d995, 0x17e44c, 0x18fafe, 0x1a1e35, 0x1b4e82 };
+
+#ifndef USER_TARGET_PLATFORM
+// Note to frequency LUT (osc_notehzf), desktop builds: 440 * 2**((note - 69) / 12), rounded to float
+// (the logue firmware has the same table)
+const float midi_to_hz_lut_f[k_midi_to_hz_size] = {
+    8.175799f, 8.661957f, 9.177024f, 9.722718f, 10.300861f, 10.913383f, 11.5623255f, 12.249857f, 12.9782715f, 13.75f,
+    14.567617f, 15.433853f, 16.351599f, 17.323914f, 18.354048f, 19.445436f, 20.601723f, 21.826765f, 23.124651f,
+    24.499714f, 25.956543f, 27.5f, 29.135235f, 30.867706f, 32.703197f, 34.647827f, 36.708096f, 38.890873f, 41.203445f,
+    43.65353f, 46.249302f, 48.999428f, 51.913086f, 55.f, 58.27047f, 61.735413f, 65.406395f, 69.295654f, 73.41619f,
+    77.781746f, 82.40689f, 87.30706f, 92.498604f, 97.998856f, 103.82617f, 110.f, 116.54094f, 123.470825f, 130.81279f,
+    138.59131f, 146.83238f, 155.56349f, 164.81378f, 174.61412f, 184.99721f, 195.99771f, 207.65234f, 220.f, 233.08188f,
+    246.94165f, 261.62558f, 277.18262f, 293.66476f, 311.12698f, 329.62756f, 349.22824f, 369.99442f, 391.99542f,
+    415.3047f, 440.f, 466.16376f, 493.8833f, 523.25116f, 554.36523f, 587.3295f, 622.25397f, 659.2551f, 698.4565f,
+    739.98883f, 783.99084f, 830.6094f, 880.f, 932.3275f, 987.7666f, 1046.5023f, 1108.7305f, 1174.659f, 1244.5079f,
+    1318.5103f, 1396.913f, 1479.9777f, 1567.9817f, 1661.2188f, 1760.f, 1864.655f, 1975.5332f, 2093.0046f, 2217.461f,
+    2349.318f, 2489.0159f, 2637.0205f, 2793.826f, 2959.9553f, 3135.9634f, 3322.4375f, 3520.f, 3729.31f, 3951.0664f,
+    4186.0093f, 4434.922f, 4698.636f, 4978.0317f, 5274.041f, 5587.652f, 5919.9106f, 6271.927f, 6644.875f, 7040.f,
+    7458.62f, 7902.133f, 8372.019f, 8869.844f, 9397.272f, 9956.063f, 10548.082f, 11175.304f, 11839.821f, 12543.854f,
+    13289.75f, 14080.f, 14917.24f, 15804.266f, 16744.037f, 17739.688f, 18794.545f, 19912.127f, 21096.164f, 22350.607f,
+    23679.643f, 25087.707f, 26579.5f, 28160.f, 29834.48f, 31608.531f, 33488.074f, 35479.375f, 37589.09f, 39824.254f,
+    42192.33f, 44701.215f, 47359.285f, 50175.414f
+};
+#endif
+
+// Adaptive oversampling: the factor is increased if the wave is read with a step larger than
+// OVS_STEP_UP samples per generated sample, and decreased if the step at the lower factor
+// would be below OVS_STEP_DOWN (hysteresis of c.a. 2 semitones).
+// 0.8 is c.a. 300 Hz at 1x: at lower pitches, 1x has the same aliasing as 8x.
+#define OVS_STEP_UP 0.8f
+#define OVS_STEP_DOWN 0.7f
+
+// Number of envelope + LFO values rendered at once, one per sub-block of MOD_STRIDE samples
+#define MOD_VALUES 32
+
+// Output saturation: the largest Q31 value, and 2^31 - the first float that does not fit in int32
+#define Q31_MAX 0x7FFFFFFF
+#define Q31_MAX_F 2147483648.f
+
+/*  select_ovs
+    Select the oversampling factor for a frequency, with hysteresis.
+    Returns: log2 of the factor
+*/
+__fast_inline uint8_t select_ovs(uint8_t ovs_log2, float freq, float srate_recip)
+{
+    const float step = freq * (128.f * srate_recip); // wave samples per output sample
+    while ((ovs_log2 < OVS_MAX_LOG2) && (step > OVS_STEP_UP * (float)(1 << ovs_log2)))
+        ovs_log2++;
+    while ((ovs_log2 > 0) && (step < OVS_STEP_DOWN * (float)(1 << (ovs_log2 - 1))))
+        ovs_log2--;
+    return ovs_log2;
+}
+
+/*  apply_frequency
+    Set the frequency for a pitch.
+    nframes: 0 - immediately, otherwise ramp the phase step over nframes output samples
+    The oversampling factor for the new frequency is selected first: if it changes
+    (or a crossfade is running), the frequency is set immediately, because the crossfade
+    sets the frequency again for both factors.
+    Not inlined, it is called only when the pitch changes.
+*/
+static void apply_frequency(WvTableVoice* voice, uint16_t pitch, uint32_t nframes)
+{
+    const float freq = wvt_pitch_hz(pitch);
+    voice->freq = freq;
+    voice->params.pitch = pitch;
+    if (voice->params.ovs_auto)
+        voice->ovs_target = select_ovs(voice->ovs_log2, freq, voice->srate_recip); // applied in wvt_cycle
+    if (nframes && !voice->xfade_left && (voice->ovs_target == voice->ovs_log2))
+        set_frequency_ramp(&voice->gen, freq, nframes << voice->ovs_log2);
+    else
+        set_frequency(&voice->gen, freq);
+}
+
+/*  update_pitch
+    Move the pitch towards the requested one (glide) and update the frequency for the next block.
+    pitch: requested pitch, UQ8.8
+    nframes: number of output samples in the block
+    ramp: 1 - the phase step changes linearly over the block (pitch modulation without steps),
+          0 - the frequency is set immediately
+*/
+__fast_inline void update_pitch(WvTableVoice* voice, uint16_t pitch, uint32_t nframes, int ramp)
+{
+    const uint32_t target = (uint32_t)pitch << 16;
+    uint32_t glide_pitch = voice->glide_pitch;
+    if (glide_pitch != target) {
+        const uint64_t d = (uint64_t)voice->glide_step * nframes;
+        if (!voice->glide_step)
+            glide_pitch = target;
+        else if (glide_pitch < target)
+            glide_pitch = (target - glide_pitch > d) ? glide_pitch + d : target;
+        else
+            glide_pitch = (glide_pitch - target > d) ? glide_pitch - d : target;
+        voice->glide_pitch = glide_pitch;
+    }
+    pitch = (uint16_t)(glide_pitch >> 16);
+    if (pitch == voice->params.pitch)
+        return;
+    apply_frequency(voice, pitch, ramp ? nframes : 0);
+}
+
+__fast_inline void reset_decimators(WvTableVoice* voice, uint8_t chain)
+{
+    uint8_t k;
+    for (k = 0; k < OVS_STAGES; k++)
+        decimator_reset(&voice->dec[chain][k]);
+}
+
+/*  set_gen_rate
+    Set the generator sampling rate and the phase step for an oversampling factor.
+*/
+__fast_inline void set_gen_rate(WvTableVoice* voice, uint8_t ovs_log2)
+{
+    wtgen_set_srate(&voice->gen, (float)(voice->srate << ovs_log2));
+    set_frequency(&voice->gen, voice->freq);
+}
+
+/*  scale_rate
+    Scale an envelope or LFO rate from 48 kHz to the output rate.
+    FIXED_ONE (no envelope stage, no delay) is not scaled.
+*/
+__fast_inline uint32_t scale_rate(const WvTableVoice* voice, uint32_t rate)
+{
+    if (rate >= FIXED_ONE)
+        return rate;
+    const uint64_t r = ((uint64_t)rate * voice->rate_scale) >> 16;
+    return (r < FIXED_ONE) ? (uint32_t)r : FIXED_ONE - 1;
+}
+
+/*  glide_step
+    Returns: pitch change per sample for the glide rate, UQ8.24, 0: no glide
+    (the rate is given as for the envelope, a full envelope stage is one octave)
+*/
+__fast_inline uint32_t glide_step(const WvTableVoice* voice)
+{
+    const uint32_t rate = voice->params.glide_rate;
+    if (rate >= FIXED_ONE)
+        return 0;
+    const uint32_t step = (uint32_t)(((uint64_t)scale_rate(voice, rate) * 3) >> 5); // (12 << 24) / FIXED_ONE
+    return step ? step : 1;
+}
+
+/*  fixed_ovs
+    Returns: the fixed oversampling factor for the output rate, log2
+*/
+__fast_inline uint8_t fixed_ovs(const WvTableVoice* voice)
+{
+    const uint8_t ovs_sel = voice->params.ovs_sel;
+    return (ovs_sel > voice->srate_shift) ? (uint8_t)(ovs_sel - voice->srate_shift) : 0;
+}
+
+/*  wvt_set_ovs
+    Change the oversampling factor immediately.
+*/
+void wvt_set_ovs(WvTableVoice* voice, uint8_t ovs_log2)
+{
+    if (ovs_log2 > OVS_MAX_LOG2)
+        ovs_log2 = OVS_MAX_LOG2;
+    voice->ovs_target = ovs_log2;
+    voice->xfade_left = 0;
+    if (ovs_log2 != voice->ovs_log2) {
+        voice->ovs_log2 = ovs_log2;
+        set_gen_rate(voice, ovs_log2);
+    }
+    reset_decimators(voice, voice->dec_sel);
+}
+
+/*  generate_samples
+    Generate n samples at the generator rate (generate_block).
+    Not inlined: called for each sub-block and twice by the crossfade.
+*/
+_NOINLINE void generate_samples(WvTableVoice* voice, wtsample_t* buf, uint32_t n)
+{
+    generate_block(&voice->gen, buf, n);
+}
+
+/*  start_crossfade
+    Switch to the requested oversampling factor during a note.
+    The previous factor is generated in parallel until the end of the crossfade.
+*/
+static void start_crossfade(WvTableVoice* voice)
+{
+    voice->ovs_prev = voice->ovs_log2;
+    voice->ovs_log2 = voice->ovs_target;
+    voice->dec_sel ^= 1;
+    reset_decimators(voice, voice->dec_sel);
+    set_gen_rate(voice, voice->ovs_log2);
+    voice->xfade_left = OVS_XFADE;
+}
+
+/*  generate_crossfade
+    Generate a block of samples at the previous and the current oversampling factor,
+    starting from the same phase (and pending step residual), decimate both and crossfade linearly.
+    buf: output samples, n (also used for the oversampled samples)
+    n: number of output samples
+*/
+static void generate_crossfade(WvTableVoice* voice, wtsample_t* buf, uint32_t n)
+{
+    wtsample_t buf_prev[GEN_BLOCK * OVS_MAX];
+    const uq7_25_t phase = voice->gen.phase;
+    const BlepState blep = voice->gen.blep;
+    const uint8_t ovs_prev = voice->ovs_prev;
+    const uint8_t ovs_log2 = voice->ovs_log2;
+    uint32_t i;
+
+    // previous factor
+    set_gen_rate(voice, ovs_prev);
+    generate_samples(voice, buf_prev, n << ovs_prev);
+    decimator_cascade(voice->dec[voice->dec_sel ^ 1], buf_prev, n, ovs_prev);
+    // current factor
+    voice->gen.phase = phase;
+    voice->gen.blep = blep;
+    set_gen_rate(voice, ovs_log2);
+    generate_samples(voice, buf, n << ovs_log2);
+    decimator_cascade(voice->dec[voice->dec_sel], buf, n, ovs_log2);
+
+    for (i = 0; (i < n) && voice->xfade_left; i++) {
+        // weight of the previous factor: xfade_left / OVS_XFADE
+        buf[i] += (buf_prev[i] - buf[i]) / OVS_XFADE * (voice->xfade_left--);
+    }
+}
+
+/*  wvt_init
+    Initialize the voice.
+*/
+void wvt_init(WvTableVoice* voice)
+{
+    voice->ovs_log2 = voice->ovs_target = voice->ovs_prev = OVS_DEFAULT_LOG2;
+    voice->dec_sel = 0;
+    voice->xfade_left = 0;
+#ifdef OVS_AUTO
+    voice->params.ovs_auto = 1;
+#else
+    voice->params.ovs_auto = 0;
+#endif
+    voice->params.pitch = 0;
+    voice->params.ovs_sel = OVS_DEFAULT_LOG2;
+    voice->srate = k_samplerate;
+    voice->srate_recip = k_samplerate_recipf;
+    voice->rate_scale = 1 << 16;
+    voice->srate_shift = 0;
+    wtgen_init(&voice->gen, (float)(k_samplerate << OVS_DEFAULT_LOG2));
+    envlfo_init(&voice->mod, k_samplerate);
+#ifdef WTGEN_MIPMAP
+    wtgen_set_bandlimit(&voice->gen, 1);
+#endif
+    voice->params.nwave = 0;
+    voice->params.env_arate = ENV_LUT[0];
+    voice->params.env_drate = ENV_LUT[0];
+    voice->params.lfo_rate = LFO_LUT[0];
+    voice->params.lfo_delay = ENV_LUT[0];
+    voice->params.pitch = 0;
+    voice->params.wt_num = 0;
+    voice->params.env_hold = 0;
+    voice->params.glide_rate = ENV_LUT[0];
+    voice->glide_pitch = 0;
+    voice->glide_step = 0;
+    apply_frequency(voice, 0, 0);
+    reset_decimators(voice, 0);
+    reset_decimators(voice, 1);
+}
+
+/*  wvt_set_srate
+    Set the output sampling rate.
+*/
+void wvt_set_srate(WvTableVoice* voice, uint32_t srate)
+{
+    uint8_t shift = 0;
+    // the factor is reduced by one for each doubling of the rate (from 72 kHz, 144 kHz)
+    while ((shift < OVS_MAX_LOG2) && (srate >= ((uint32_t)(k_samplerate * 3) << shift) / 2))
+        shift++;
+    voice->srate = srate;
+    voice->srate_recip = 1.f / (float)srate;
+    voice->rate_scale = (uint32_t)(((uint64_t)k_samplerate << 16) / srate);
+    voice->srate_shift = shift;
+    voice->mod.sample_rate = (float)srate;
+    // the envelope rates are applied on Note On
+    envlfo_set_lfo_rate(&voice->mod, scale_rate(voice, voice->params.lfo_rate));
+    envlfo_set_lfo_delay_rate(&voice->mod, scale_rate(voice, voice->params.lfo_delay));
+    voice->glide_step = glide_step(voice);
+    if (voice->params.ovs_auto)
+        voice->ovs_target = select_ovs(voice->ovs_log2, voice->freq, voice->srate_recip);
+    else
+        voice->ovs_target = fixed_ovs(voice);
+    wvt_set_ovs(voice, voice->ovs_target);
+    set_gen_rate(voice, voice->ovs_log2);
+}
+
+/*  wvt_noteon
+    Start a note.
+*/
+void wvt_noteon(WvTableVoice* voice, const user_osc_param_t* const params)
+{
+    // glide from the pitch of the previous note, if there was one
+    if (!voice->glide_step || !voice->glide_pitch)
+        voice->glide_pitch = (uint32_t)params->pitch << 16;
+    update_pitch(voice, params->pitch, 0, 0);
+    // no crossfade at the note start, the decimators are reset anyway
+    wvt_set_ovs(voice, voice->ovs_target);
+    // prepare the oscillator
+    wtgen_reset(&voice->gen);
+    apply_wavetable(&voice->gen);
+    // prepare the modulator
+    envlfo_set_arate(&voice->mod, scale_rate(voice, voice->params.env_arate));
+    envlfo_set_drate(&voice->mod, scale_rate(voice, voice->params.env_drate));
+    envlfo_set_hold(&voice->mod, voice->params.env_hold);
+    envlfo_note_on(&voice->mod);
+}
+
+/*  wvt_noteoff
+    Release the note.
+*/
+void wvt_noteoff(WvTableVoice* voice)
+{
+    envlfo_note_off(&voice->mod);
+}
+
+#ifdef WTGEN_SMOOTH
+/*  ramp_wave
+    Ramp the wave number over the block, from the previous value
+    (set immediately when the oversampling factor changes: the crossfade generates the block twice).
+    Not inlined, update_wave is called for each block.
+    nwave: wave number at the end of the block
+    nframes: number of output samples in the block
+*/
+static void ramp_wave(WvTableVoice* voice, q7_24_t nwave, uint32_t nframes)
+{
+    if (!voice->xfade_left && (voice->ovs_target == voice->ovs_log2))
+        set_wave_ramp(&voice->gen, nwave, nframes << voice->ovs_log2);
+    else
+        set_wave_number(&voice->gen, nwave);
+}
+#endif
+
+/*  update_wave
+    Set the wave number for the next block.
+    mod: envelope + LFO value at the end of the block
+    nframes: number of output samples in the block
+*/
+__fast_inline void update_wave(WvTableVoice* voice, const user_osc_param_t* const params, q7_24_t mod, uint32_t nframes)
+{
+    // Calculate the wavetable index (Q7.24).
+    q7_24_t nwave = voice->params.nwave;
+    // main LFO modulation
+    nwave += params->shape_lfo;
+    // internal envelope + LFO
+    nwave += mod;
+    // Any overflow will be handled within set_wave_number.
+#ifdef WTGEN_SMOOTH
+    // the index is ramped over the block, from the previous value
+    ramp_wave(voice, nwave, nframes);
+#else
+    (void)nframes;
+    set_wave_number(&voice->gen, nwave);
+#endif
+}
+
+/*  wvt_update
+    Update the pitch and the wave number for the next block of a voice bank.
+*/
+void wvt_update(WvTableVoice* voice, const user_osc_param_t* const params, const uint32_t nframes)
+{
+    // check for pitch change (it may be modulated), the step is changed immediately
+    update_pitch(voice, params->pitch, nframes, 0);
+    // index changes are updated once per block, internal envelope + LFO at the last sample
+    update_wave(voice, params, envlfo_get(&voice->mod, nframes), nframes);
+}
+
+/*  wvt_cycle
+    Generate a buffer of samples.
+    The samples are generated in blocks of GEN_BLOCK samples, each in sub-blocks of MOD_STRIDE samples:
+    the wave number is updated for each sub-block (with WTGEN_SMOOTH, ramped to the value at its end),
+    the envelope + LFO values for up to MOD_VALUES sub-blocks are rendered at once.
+    The oversampled blocks are decimated as a whole.
+*/
+void wvt_cycle(WvTableVoice* voice, const user_osc_param_t* const params, int32_t* framebuf, const uint32_t nframes)
+{
+    // check for pitch change (it may be modulated), the step is ramped over the buffer
+    update_pitch(voice, params->pitch, nframes, 1);
+
+    // sample generation, in blocks of up to GEN_BLOCK output samples
+    wtsample_t buf[GEN_BLOCK * OVS_MAX];
+    q7_24_t mod[MOD_VALUES];
+    q31_t* __restrict py = (q31_t*)framebuf;
+    uint32_t nleft = nframes;
+    uint32_t nmod = 0; // number of unused values in mod
+    uint32_t imod = 0;
+    while (nleft) {
+        const uint32_t n = (nleft < GEN_BLOCK) ? nleft : GEN_BLOCK;
+        if ((voice->ovs_target != voice->ovs_log2) && !voice->xfade_left)
+            start_crossfade(voice);
+        const uint8_t ovs_log2 = voice->ovs_log2;
+        const int xfade = voice->xfade_left != 0;
+        q7_24_t mod_val = 0;
+        uint32_t i, k;
+        for (i = 0; i < n; i += k) {
+            k = (n - i < MOD_STRIDE) ? n - i : MOD_STRIDE;
+            if (!nmod) {
+                // envelope + LFO at the end of each sub-block: full sub-blocks, then the last partial one
+                const uint32_t nfull = (nleft - i) / MOD_STRIDE;
+                nmod = nfull ? ((nfull < MOD_VALUES) ? nfull : MOD_VALUES) : 1;
+                envlfo_render(&voice->mod, mod, nmod, k);
+                imod = 0;
+            }
+            mod_val = mod[imod++];
+            nmod--;
+            if (!xfade) {
+                update_wave(voice, params, mod_val, k);
+                generate_samples(voice, buf + (i << ovs_log2), k << ovs_log2);
+            }
+        }
+        if (xfade) {
+            // the crossfade generates the whole block twice, with the wave number at its end
+            update_wave(voice, params, mod_val, n);
+            generate_crossfade(voice, buf, n);
+        } else {
+            // decimate the oversampled signal, in place
+            decimator_cascade(voice->dec[voice->dec_sel], buf, n, ovs_log2);
+        }
+        const wtsample_t* __restrict px = buf;
+        const q31_t* const py_e = py + n;
+        while (py != py_e) {
+            // convert float (-128..128) to Q31
+            // scale by c.a. 0.95 to account for the ringing caused by the decimation,
+            // saturate the peaks that still exceed the Q31 range
+#ifdef WTGEN_Q15
+            const int64_t y = ((int64_t)*(px++) * 15000000) >> 20; // the same scaling, from Q8.20
+            *(py++) = (int32_t)((y > Q31_MAX) ? Q31_MAX : ((y < -Q31_MAX) ? -Q31_MAX : y));
+#else
+            const float y = *(px++) * 15000000.f + 0.5f;
+            *(py++) = (y >= Q31_MAX_F) ? Q31_MAX : ((y <= -Q31_MAX_F) ? -Q31_MAX : (int32_t)y);
+#endif
+        }
+        nleft -= n;
+    }
+}
+
+/*  wvt_param
+    Set a parameter of the voice.
+*/
+void wvt_param(WvTableVoice* voice, uint16_t index, uint16_t value)
+{
+
+    switch (index) {
+    case k_user_osc_param_id1:
+        // Param 1: wavetable number (0..95)
+        voice->params.wt_num = (uint8_t)value;
+        // the wave indices are built now, the wavetable is switched on Note On
+        prepare_wavetable(&voice->gen, (uint8_t)value);
+        break;
+
+    case k_user_osc_param_id2:
+        // Param2: wave envelope attack time (0..100)
+        voice->params.env_arate = ENV_LUT[value];
+        // will be applied on Note On
+        break;
+
+    case k_user_osc_param_id3:
+        // Param3: wave envelope decay time (1..200)
+        if (value >= 100) {
+            // positive values: ASR envelope
+            voice->params.env_drate = ENV_LUT[value - 100];
+            voice->params.env_hold = 1;
+        } else if (value > 0) {
+            // negative values: AD emvelope
+            voice->params.env_drate = ENV_LUT[100 - value];
+            voice->params.env_hold = 0;
+        } else {
+            // value 0: disable envelope (minilogue bug)
+            voice->params.env_drate = ENV_LUT[0];
+            voice->params.env_hold = 0;
+        }
+        // will be applied on Note On
+        break;
+
+    case k_user_osc_param_id4:
+        // Param4: wave envelope amount (1..200)
+        // param (1..200) to amnount (-99..100)
+        // ignore 0 value - logue bug
+        {
+            const int32_t env_amount = (value > 0) ? ((int32_t)value - 100) : 0;
+            envlfo_set_env_amount(&voice->mod, (int8_t)env_amount);
+        }
+        break;
+
+    case k_user_osc_param_id5:
+        // Param5: LFO2 rate (0..100), maps to 0..20 Hz, exponential curve
+        voice->params.lfo_rate = LFO_LUT[value];
+        envlfo_set_lfo_rate(&voice->mod, scale_rate(voice, voice->params.lfo_rate));
+        break;
+
+    case k_user_osc_param_id6:
+        // Param6: LFO2 amount (0..100)
+        envlfo_set_lfo_amount(&voice->mod, (int8_t)value);
+        break;
+
+    case k_user_osc_param_shape:
+        // Shape: wavetable index
+        // 10 bit value (UQ6.4) mapped to Q7.24
+        voice->params.nwave = value << 20;
+        break;
+
+    case k_user_osc_param_shiftshape:
+        // Shift+Shape: phase skew
+        // breakpoint = 64 - (value/16)
+        set_skew(&voice->gen, (uq7_25_t)(1024UL - (uint32_t)value) << 21); // UQ7.25
+        break;
+
+    case k_wvt_param_ovs:
+        // Oversampling factor (0..3: 1x..8x, 4: adaptive), desktop builds
+        // a change during a note is crossfaded in wvt_cycle
+        if (value >= OVS_AUTO_VALUE) {
+            voice->params.ovs_auto = 1;
+            voice->ovs_target = select_ovs(voice->ovs_log2, voice->freq, voice->srate_recip);
+        } else {
+            voice->params.ovs_auto = 0;
+            voice->params.ovs_sel = (value < OVS_MAX_LOG2) ? (uint8_t)value : OVS_MAX_LOG2;
+            voice->ovs_target = fixed_ovs(voice);
+        }
+        break;
+
+    case k_wvt_param_lfo_shape:
+        // LFO2 shape (LfoShape), desktop builds
+        envlfo_set_lfo_shape(&voice->mod, (uint8_t)value);
+        break;
+
+    case k_wvt_param_lfo_free:
+        // LFO2 phase: key sync or free run, desktop builds
+        envlfo_set_lfo_free(&voice->mod, value ? 1 : 0);
+        break;
+
+    case k_wvt_param_lfo_delay:
+        // LFO2 delay (0..100), desktop builds
+        // will be applied on Note On
+        voice->params.lfo_delay = ENV_LUT[(value <= 100) ? value : 100];
+        envlfo_set_lfo_delay_rate(&voice->mod, scale_rate(voice, voice->params.lfo_delay));
+        break;
+
+    case k_wvt_param_glide:
+        // glide (portamento) time (0..100, 0: off), desktop builds
+        voice->params.glide_rate = ENV_LUT[(value <= 100) ? value : 100];
+        voice->glide_step = glide_step(voice);
+        break;
+
+    default:
+        break;
+    }
+}
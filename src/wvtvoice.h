@@ -0,0 +1,207 @@
+#pragma once
+#ifndef _WVTVOICE_H
+#define _WVTVOICE_H
+
+/*
+ * wvtvoice.h
+ * A single instance (voice) of the WvTable oscillator.
+ * All the oscillator state is kept in WvTableVoice, so any number of voices
+ * may be run independently, e.g. in a polyphonic plugin or in several threads.
+ * The logue SDK callbacks (WvTable.c) use a single voice.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#ifdef USER_TARGET_PLATFORM
+#include <userosc.h> // Logue SDK header
+#else
+#include "userosc2.h" // compatibility header
+#endif
+
+#include "compat.h"
+#include "wtgen.h"
+#include "envlfo.h"
+#include "decimator.h"
+
+/*
+    Anti-aliasing mode. The default mode may be selected on the compiler command line:
+    OVS_2x (default) - PPG style: original waves generated at 2x sample rate, then decimated
+    OVS_4x - as above, 4x sample rate
+    WTGEN_MIPMAP - band-limited waves generated at the sample rate, no decimator
+                   (desktop builds only, the tables do not fit in the logue memory)
+    OVS_AUTO - the factor is selected from the pitch (see below)
+    On desktop builds, the oversampling factor may be changed at run time
+    (k_wvt_param_ovs: 1x, 2x, 4x or 8x), the signal is decimated by a cascade of halfband stages.
+    The logue builds have buffers only for the default factor.
+    The factors are given for the output rate of 48 kHz. At higher output rates (wvt_set_srate),
+    the factor is reduced, so that the generator runs at a similar rate: 2x at 48 kHz is 1x at 96 kHz.
+    Adaptive oversampling (k_wvt_param_ovs = OVS_AUTO_VALUE, or OVS_AUTO defined): the lowest factor
+    that keeps the aliasing at the level of 8x is selected from the pitch, up to the maximum factor.
+    When the factor changes during a note, the outputs of both factors are crossfaded over
+    OVS_XFADE samples.
+    The mode changes the size of WvTableVoice, so it must be the same in all source files.
+*/
+#if defined(OVS_4x)
+#define OVS_DEFAULT_LOG2 2
+#elif defined(WTGEN_MIPMAP)
+#define OVS_DEFAULT_LOG2 0
+#else
+#define OVS_DEFAULT_LOG2 1
+#endif
+
+#ifdef USER_TARGET_PLATFORM
+#define OVS_MAX_LOG2 OVS_DEFAULT_LOG2
+#else
+#define OVS_MAX_LOG2 3
+#endif
+#define OVS_MAX (1 << OVS_MAX_LOG2) // maximum oversampling factor
+#define OVS_STAGES ((OVS_MAX_LOG2 > 0) ? OVS_MAX_LOG2 : 1) // size of the decimator array
+#define OVS_AUTO_VALUE 4 // k_wvt_param_ovs value for the adaptive oversampling
+#define OVS_XFADE 64 // length of the crossfade after the factor change, in samples
+
+// Maximum number of output samples generated in one pass
+#define GEN_BLOCK 32
+// Number of output samples between the updates of the wave number (envelope + LFO), a quarter of the block.
+// MOD_STRIDE = GEN_BLOCK (make option MOD_BLOCK_RATE=1) updates it once per block, as before:
+// in Mode 1, the blended wave is rebuilt for each update while the envelope or LFO2 moves.
+#ifndef MOD_STRIDE
+#define MOD_STRIDE (GEN_BLOCK / 4)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parameters not available in the logue SDK, numbered after the SDK parameters
+typedef enum {
+    k_wvt_param_ovs = k_num_user_osc_param_id, // oversampling: 0: 1x, 1: 2x, 2: 4x, 3: 8x, 4: adaptive
+    k_wvt_param_lfo_shape, // LFO2 shape: 0: triangle, 1: sine, 2: saw, 3: square, 4: sample & hold
+    k_wvt_param_lfo_free, // LFO2 phase: 0: key sync, 1: free run
+    k_wvt_param_lfo_delay, // LFO2 delay (fade in) time, 0..100 (as the envelope times)
+    k_wvt_param_glide, // glide time per octave, 0..100 (as the envelope times), 0: off
+    k_num_wvt_param_id
+} wvt_param_id_t;
+
+// Parameters of a voice, applied on note on or on every cycle
+typedef struct {
+    q7_24_t nwave; // base wavetable index, without modulation
+    uint32_t env_arate; // envelope attack
+    uint32_t env_drate; // envelope decay/release
+    uint32_t lfo_rate; // LFO2 rate
+    uint32_t lfo_delay; // LFO2 delay (fade in) rate
+    uint32_t glide_rate; // glide rate, FIXED_ONE: off
+    uint16_t pitch; // last pitch value that was received
+    uint8_t wt_num; // wavetable number
+    int8_t env_hold; // 1: ASR envelope, 0: AD envelope
+    uint8_t ovs_auto; // 1: oversampling factor selected from the pitch
+    uint8_t ovs_sel; // selected oversampling factor at 48 kHz, log2
+} WvTableParams;
+// (the rates are given for 48 kHz and scaled to the output rate when applied)
+
+// Complete state of a single oscillator voice
+typedef struct {
+    WvTableParams params; // voice parameters
+    WtGenState gen; // wavetable generator
+    EnvLfoState mod; // wave index modulator
+    DecimatorState dec[2][OVS_STAGES]; // two decimator chains, dec[c][k]: 2**(k+1) to 2**k
+    float freq; // current frequency in Hz
+    uint32_t glide_pitch; // current pitch with glide, UQ8.24, 0: no note played yet
+    uint32_t glide_step; // glide pitch change per sample, UQ8.24, 0: off
+    uint32_t srate; // output sampling rate in Hz
+    float srate_recip; // 1 / srate
+    uint32_t rate_scale; // envelope and LFO rate scaling, 48000 / srate, UQ16.16
+    uint8_t srate_shift; // oversampling factor reduction for the output rate, log2
+    uint8_t ovs_log2; // current oversampling factor, log2
+    uint8_t ovs_target; // requested oversampling factor, log2
+    uint8_t ovs_prev; // previous oversampling factor, used during the crossfade
+    uint8_t dec_sel; // decimator chain of the current factor
+    uint8_t xfade_left; // samples left to the end of the crossfade, 0: no crossfade
+} WvTableVoice;
+
+/*  wvt_pitch_hz
+    Calculate the frequency for a pitch: note from the LUT (osc_notehzf),
+    fine tune with a quadratic approximation of 2**(frac/12) (error below 0.003 cent).
+    pitch: UQ8.8, note and fine tune (0..255)
+    Returns: frequency in Hz
+*/
+_INLINE float wvt_pitch_hz(uint16_t pitch)
+{
+    const uint8_t note = (uint8_t)(pitch >> 8); // integer part of the pitch
+    const uint16_t mod = pitch & 0xFF; // fractional part of the pitch
+    float freq = osc_notehzf(note); // from lookup table
+    if (mod > 0) {
+#if 0
+        // linear interpolation
+        const float f1 = osc_notehzf(note + 1);
+        freq = clipmaxf(linintf(mod * k_note_mod_fscale, freq, f1), k_note_max_hz);
+#else
+        // quadratic approximation
+        const float frac = (float)mod * 0.00390625f; // 1/256
+        freq *= 0.00171723f * frac * frac + 0.05774266f * frac + 1.0000016f;
+#endif
+    }
+    return freq;
+}
+
+/*  wvt_init
+    Initialize the voice. Must be called before any other function.
+    All the parameters are set to zero values.
+*/
+void wvt_init(WvTableVoice* voice);
+
+/*  wvt_set_srate
+    Set the output sampling rate (default: k_samplerate, 48 kHz).
+    The pitch, the envelope and LFO times are kept, the oversampling factor is reduced at high rates.
+    Call between the notes: the decimators are reset.
+    srate: sampling rate in Hz
+*/
+void wvt_set_srate(WvTableVoice* voice, uint32_t srate);
+
+/*  wvt_noteon
+    Start a note.
+    params.pitch: note pitch, UQ8.8.
+*/
+void wvt_noteon(WvTableVoice* voice, const user_osc_param_t* const params);
+
+/*  wvt_noteoff
+    Release the note.
+*/
+void wvt_noteoff(WvTableVoice* voice);
+
+/*  wvt_set_ovs
+    Change the oversampling factor immediately, without the crossfade.
+    The decimators are reset. Used by the voice banks, which decimate the mix.
+    With params.ovs_auto off, wvt_noteon keeps the factor set here.
+    ovs_log2: log2 of the factor, limited to OVS_MAX_LOG2
+*/
+void wvt_set_ovs(WvTableVoice* voice, uint8_t ovs_log2);
+
+/*  wvt_update
+    Per-sub-block update used by the voice banks (wvtbank.h), which generate the samples themselves,
+    called for every MOD_STRIDE samples: the pitch step is applied immediately (no ramp),
+    the wave number is set from a single envlfo_get value at the last of the next nframes samples.
+    wvt_cycle does not use it, it ramps the pitch over the buffer and renders the envelope + LFO
+    values for the sub-blocks at once.
+*/
+void wvt_update(WvTableVoice* voice, const user_osc_param_t* const params, const uint32_t nframes);
+
+/*  wvt_cycle
+    Generate a buffer of samples.
+    params.pitch: note pitch, uint16, UQ8.8.
+    params.shape_lfo: LFO value for shape modulation, int32.
+    framebuf: buffer for the generated samples, Q31.
+    nframes: number of samples to generate.
+*/
+void wvt_cycle(WvTableVoice* voice, const user_osc_param_t* const params, int32_t* framebuf, const uint32_t nframes);
+
+/*  wvt_param
+    Set a parameter of the voice.
+    index: parameter id (user_osc_param_id_t or wvt_param_id_t)
+    value: parameter value, as sent by the logue SDK
+*/
+void wvt_param(WvTableVoice* voice, uint16_t index, uint16_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * testbank.c
+ * Test of the voice bank: the mix rendered by wvtbank_render is compared with the sum
+ * of the same voices generated one by one with wvt_cycle.
+ * Built with the SIMD code of the host and with the scalar code (WVTBANK_SCALAR), run by ctest.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "wvtbank.h"
+
+#define NUM_VOICES 12 // voices in the bank: 3 lane groups (AVX2: 1.5)
+#define NUM_FRAMES 2048 // samples rendered in each configuration
+#define BLOCK 32 // samples per wvt_cycle / wvtbank_render call
+#define MAX_ERROR 1e-5 // maximum difference, relative to the peak of the mix
+#define Q31_MAX 0x7FFFFFFF
+#define WT_CLIP 77 // wavetable with peaks over the Q31 range of wvt_cycle
+
+// wavetables that stay within the Q31 range of wvt_cycle: the bank mix is not saturated,
+// it is compared exactly only with voices that do not clip
+static const uint8_t TABLES[] = { 0, 12, 44, 28, 29, 70 }; // modes 1, 2 and 3, computed waves
+static const uint16_t SKEWS[] = { 0, 256 };
+static const uint16_t OVS[] = { 0, 1, 2, 3, OVS_AUTO_VALUE };
+static const uint32_t SRATES[] = { 48000, 96000 };
+
+#define COUNT(a) (sizeof(a) / sizeof(a[0]))
+
+static WvTableBank bank;
+static WvTableVoice voice[NUM_VOICES];
+static uint32_t g_clipped; // reference samples saturated by wvt_cycle
+
+/*  set_param
+    Set a parameter in the bank and in the reference voices.
+*/
+static void set_param(uint16_t index, uint16_t value)
+{
+    uint32_t v;
+    wvtbank_param(&bank, index, value);
+    // the bank uses the default factor for Auto
+    if ((index == k_wvt_param_ovs) && (value == OVS_AUTO_VALUE))
+        value = OVS_DEFAULT_LOG2;
+    for (v = 0; v < NUM_VOICES; v++)
+        wvt_param(&voice[v], index, value);
+}
+
+/*  test_config
+    Render one configuration with the bank and with the single voices.
+    Returns: maximum difference relative to the peak of the mix
+*/
+static double test_config(uint8_t wt_num, uint16_t skew, uint16_t ovs, uint32_t srate)
+{
+    static float out[NUM_FRAMES];
+    static double ref[NUM_FRAMES];
+    int32_t buf[BLOCK];
+    user_osc_param_t params[NUM_VOICES];
+    float gain[NUM_VOICES];
+    double peak = 0, err = 0;
+    uint32_t v, i, k;
+
+    wvtbank_init(&bank, NUM_VOICES);
+    wvtbank_set_srate(&bank, srate);
+    for (v = 0; v < NUM_VOICES; v++) {
+        wvt_init(&voice[v]);
+        for (i = 0; i < k_num_user_osc_param_id; i++)
+            wvt_param(&voice[v], (uint16_t)i, 0);
+        wvt_set_srate(&voice[v], srate);
+    }
+    set_param(k_wvt_param_ovs, ovs);
+    set_param(k_user_osc_param_id1, wt_num);
+    set_param(k_user_osc_param_id2, 10); // envelope attack
+    set_param(k_user_osc_param_id3, 150); // ASR envelope, decay 50
+    set_param(k_user_osc_param_id4, 160); // envelope amount +60
+    set_param(k_user_osc_param_id5, 70); // LFO2 rate
+    set_param(k_user_osc_param_id6, 40); // LFO2 amount
+    set_param(k_user_osc_param_shape, 300); // wave index
+    set_param(k_user_osc_param_shiftshape, skew);
+
+    for (v = 0; v < NUM_VOICES; v++) {
+        const uint16_t pitch = (uint16_t)(((24 + 7 * v) << 8) + 37 * v); // notes 24..101, with fine tune
+        gain[v] = 1.f / (float)(v + 2);
+        wvtbank_noteon(&bank, v, pitch, gain[v]);
+        params[v] = bank.params[v];
+        wvt_noteon(&voice[v], &params[v]);
+    }
+
+    wvtbank_render(&bank, out, NUM_FRAMES);
+    for (i = 0; i < NUM_FRAMES; i++)
+        ref[i] = 0;
+    for (v = 0; v < NUM_VOICES; v++) {
+        for (i = 0; i < NUM_FRAMES; i += BLOCK) {
+            wvt_cycle(&voice[v], &params[v], buf, BLOCK);
+            for (k = 0; k < BLOCK; k++) {
+                ref[i + k] += (double)gain[v] * buf[k] * (1.0 / 2147483648.0);
+                g_clipped += (buf[k] >= Q31_MAX) || (buf[k] <= -Q31_MAX);
+            }
+        }
+    }
+    for (i = 0; i < NUM_FRAMES; i++) {
+        if (fabs(ref[i]) > peak)
+            peak = fabs(ref[i]);
+        if (fabs(out[i] - ref[i]) > err)
+            err = fabs(out[i] - ref[i]);
+    }
+    return (peak > 0) ? err / peak : 1.0;
+}
+
+/*  test_clip
+    Render a wavetable with peaks over the Q31 range with single voices.
+    The output of wvt_cycle must saturate at +-Q31_MAX, not wrap around
+    (the peaks depend on the anti-aliasing mode, they may stay within the range).
+    Returns: number of wrapped samples
+*/
+static uint32_t test_clip(void)
+{
+    int32_t buf[BLOCK];
+    uint32_t v, i, k, nsat = 0, nwrap = 0;
+
+    for (v = 0; v < NUM_VOICES; v++) {
+        user_osc_param_t params = { 0 };
+        wvt_init(&voice[v]);
+        for (i = 0; i < k_num_user_osc_param_id; i++)
+            wvt_param(&voice[v], (uint16_t)i, 0);
+        wvt_set_srate(&voice[v], 48000);
+        wvt_param(&voice[v], k_user_osc_param_id1, WT_CLIP);
+        params.pitch = (uint16_t)((24 + 7 * v) << 8);
+        wvt_noteon(&voice[v], &params);
+        for (i = 0; i < NUM_FRAMES; i += BLOCK) {
+            wvt_cycle(&voice[v], &params, buf, BLOCK);
+            for (k = 0; k < BLOCK; k++) {
+                nsat += (buf[k] == Q31_MAX) || (buf[k] == -Q31_MAX);
+                nwrap += (buf[k] == INT32_MIN);
+            }
+        }
+    }
+    printf("wavetable %u: %u samples saturated, %u wrapped\n", WT_CLIP, nsat, nwrap);
+    return nwrap;
+}
+
+int main(void)
+{
+    uint32_t t, s, o, r, nfail = 0, ntest = 0;
+    double worst = 0;
+#if defined(WVTBANK_AVX2)
+    const char* simd = "AVX2";
+#elif defined(WVTBANK_SSE2)
+    const char* simd = "SSE2";
+#elif defined(WVTBANK_NEON)
+    const char* simd = "NEON";
+#else
+    const char* simd = "scalar";
+#endif
+
+    for (t = 0; t < COUNT(TABLES); t++) {
+        for (s = 0; s < COUNT(SKEWS); s++) {
+            for (o = 0; o < COUNT(OVS); o++) {
+                for (r = 0; r < COUNT(SRATES); r++) {
+                    const double err = test_config(TABLES[t], SKEWS[s], OVS[o], SRATES[r]);
+                    ntest++;
+                    if (err > worst)
+                        worst = err;
+                    if (!(err <= MAX_ERROR)) {
+                        nfail++;
+                        printf("FAIL wavetable %u skew %u ovs %u srate %u: error %.3g\n", TABLES[t], SKEWS[s],
+                            OVS[o], SRATES[r], err);
+                    }
+                }
+            }
+        }
+    }
+    printf("%s, %u voices: %u/%u configurations passed, worst error %.3g of the peak\n", simd, NUM_VOICES,
+        ntest - nfail, ntest, worst);
+    if (g_clipped) {
+        // the test wavetables must not clip, the comparison would not be exact
+        printf("FAIL %u reference samples saturated\n", g_clipped);
+        nfail++;
+    }
+    nfail += test_clip();
+    return nfail ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * testmod.c
+ * Test of the wave number modulation in wvt_cycle: the envelope + LFO values are applied
+ * for each sub-block of MOD_STRIDE samples, so the wave number must move within
+ * a generated block of GEN_BLOCK samples. The generator of the voice is wrapped,
+ * the wrapper records the wave numbers it is called with. Run by ctest.
+ * Author: Grzegorz Szwoch (GregVuki)
+ */
+
+#include <stdio.h>
+#include "wvtvoice.h"
+
+#define NUM_BLOCKS 64 // blocks of GEN_BLOCK samples rendered in each configuration
+#define MAX_CHANGES 64 // wave numbers recorded in a block
+#define MIN_UPDATES (GEN_BLOCK / 8) // the wave number must move at least every 8 samples
+
+static WvTableVoice voice;
+static void (*generate)(struct WtGenState*, wtsample_t*, uint32_t); // generator of the voice
+static q7_24_t g_wavenum[MAX_CHANGES]; // wave numbers seen by the generator in the current block
+static uint32_t g_count; // number of the recorded wave numbers
+
+/*  generate_spy
+    Record the wave number, if it changed, and call the generator of the voice.
+*/
+static void generate_spy(struct WtGenState* state, wtsample_t* out, uint32_t n)
+{
+    if ((!g_count || (g_wavenum[g_count - 1] != state->last_wavenum)) && (g_count < MAX_CHANGES))
+        g_wavenum[g_count++] = state->last_wavenum;
+    generate(state, out, n);
+}
+
+/*  test_config
+    Play a note with the wave envelope or the LFO2 modulating the wave number.
+    attack: envelope attack time (0..100), amount: envelope amount (-100..100)
+    lfo_rate, lfo_amount: LFO2 rate and amount (0..100)
+    Returns: the smallest number of wave numbers used in a block
+*/
+static uint32_t test_config(uint16_t attack, int16_t amount, uint16_t lfo_rate, uint16_t lfo_amount)
+{
+    int32_t buf[GEN_BLOCK];
+    user_osc_param_t params = { 0 };
+    uint32_t i, b, fewest = MAX_CHANGES;
+
+    wvt_init(&voice);
+    for (i = 0; i < k_num_user_osc_param_id; i++)
+        wvt_param(&voice, (uint16_t)i, 0);
+    wvt_set_srate(&voice, 48000);
+    wvt_param(&voice, k_user_osc_param_id1, 0); // wavetable 0, mode 1
+    wvt_param(&voice, k_user_osc_param_id2, attack);
+    wvt_param(&voice, k_user_osc_param_id3, 150); // ASR envelope: the LFO2 runs after the attack
+    wvt_param(&voice, k_user_osc_param_id4, (uint16_t)(amount + 100));
+    wvt_param(&voice, k_user_osc_param_id5, lfo_rate);
+    wvt_param(&voice, k_user_osc_param_id6, lfo_amount);
+    wvt_param(&voice, k_user_osc_param_shape, 200);
+    params.pitch = 60 << 8;
+    wvt_noteon(&voice, &params);
+    // the generator is selected on Note On
+    generate = voice.gen.generate;
+    voice.gen.generate = &generate_spy;
+
+    for (b = 0; b < NUM_BLOCKS; b++) {
+        g_count = 0;
+        wvt_cycle(&voice, &params, buf, GEN_BLOCK);
+        if (g_count < fewest)
+            fewest = g_count;
+    }
+    return fewest;
+}
+
+int main(void)
+{
+    const uint32_t expected = (GEN_BLOCK / MOD_STRIDE > MIN_UPDATES) ? GEN_BLOCK / MOD_STRIDE : MIN_UPDATES;
+    const uint32_t env = test_config(1, 60, 0, 0); // envelope attack
+    const uint32_t lfo = test_config(0, 0, 100, 100); // LFO2 at 20 Hz
+    uint32_t nfail = 0;
+
+    printf("wave numbers in a block of %u samples: envelope %u, LFO2 %u (expected %u)\n", GEN_BLOCK, env, lfo,
+        expected);
+    if (env < expected) {
+        printf("FAIL the envelope does not move the wave number within the block\n");
+        nfail++;
+    }
+    if (lfo < expected) {
+        printf("FAIL the LFO2 does not move the wave number within the block\n");
+        nfail++;
+    }
+    return nfail ? 1 : 0;
+}